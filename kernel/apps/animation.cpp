@@ -11,25 +11,52 @@
 #include <apps/animation.hpp>
 #include <dev/vga/graphics.hpp>
 #include <dev/vga/fb.hpp>
+#include <sys/tasks.hpp>
+#include <sys/threadpool.hpp>
+
+// redraw at 30 frames per second, with up to 10ms to draw each frame
+#define ANIMATION_PERIOD_NS     (1000ULL * 1000 * 1000 / 30)
+#define ANIMATION_RUNTIME_NS    (10ULL * 1000 * 1000)
+#define ANIMATION_BACKGROUND_SIZE   281
+#define ANIMATION_BAND_SIZE         40
 
 namespace apps {
 
 void testAnimation() 
 {
     int x = 10;
+    // ask for a guaranteed budget every frame, or at least keep the frame
+    // period by sleeping if there is no bandwidth left to admit us
+    bool deadline = tasks_set_deadline(this_cpu_read(current_task), ANIMATION_RUNTIME_NS,
+        ANIMATION_PERIOD_NS, ANIMATION_PERIOD_NS) == 0;
+    // don't hand the pool bands that would fall off a smaller screen
+    fb::FramebufferInfo info = fb::getInfo();
+    size_t rows = ANIMATION_BACKGROUND_SIZE;
+    if (info.getHeight() < rows) {
+        rows = info.getHeight();
+    }
     while (1) {
         if (x > 250)
             x = 10;
 
         fb::resetDoubleBuffer();
-        //background
-        fb::putrect(0,0,280,280,0x00FFFF);
+        //background, painted in bands by the thread pool so that joining
+        //them wakes us while we are a deadline (or throttled group) task
+        auto band = [](size_t lo, size_t hi) {
+            fb::putrect(0,lo,280,hi-lo-1,0x00FFFF);
+        };
+        parallel_for(0, rows, ANIMATION_BAND_SIZE, band);
         x+=10;
         //snake
         fb::putrect(x,10,10,10,0xFF0000);
         //apple
         fb::putrect(50,30,10,10,0xFFFF00);
         fb::swap();
+        if (deadline) {
+            tasks_wait_period();
+        } else {
+            tasks_nano_sleep(ANIMATION_PERIOD_NS);
+        }
     }
 }
 
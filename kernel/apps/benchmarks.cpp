@@ -0,0 +1,336 @@
+/**
+ * @file benchmarks.cpp
+ * @author Panix Contributors
+ * @brief Kernel benchmarks, built with `make benchmark`
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <stddef.h>
+
+#include <lib/mutex.hpp>
+#include <lib/semaphore.hpp>
+#include <lib/channel.hpp>
+#include <sys/tasks.hpp>
+#include <sys/async.hpp>
+#include <arch/arch.hpp>
+#include <dev/serial/rs232.hpp>
+#include <apps/primes.hpp>
+#include <apps/benchmarks.hpp>
+
+namespace apps {
+
+#define CONTENTION_TASKS        8
+#define CONTENTION_ITERATIONS   2000
+// busy work done while holding the lock, long enough that
+// tasks regularly get preempted inside the critical section
+#define CONTENTION_HOLD_SPINS   2000
+
+static Mutex contention_mutex("bench_contention");
+static Semaphore contention_done(0, false, "bench_contention_done");
+static volatile uint32_t contention_counter;
+static task_t contention_tasks[CONTENTION_TASKS];
+
+static void _contention_task(void)
+{
+    for (size_t i = 0; i < CONTENTION_ITERATIONS; i++) {
+        contention_mutex.Lock();
+        uint32_t value = contention_counter;
+        for (size_t spin = 0; spin < CONTENTION_HOLD_SPINS; spin++) {
+            asm volatile("pause");
+        }
+        contention_counter = value + 1;
+        contention_mutex.Unlock();
+    }
+    contention_done.Post();
+}
+
+static void bench_mutex_contention(void)
+{
+    contention_counter = 0;
+    uint32_t switches = this_cpu_read(nr_switches);
+    uint64_t start = tasks_get_time();
+    for (size_t i = 0; i < CONTENTION_TASKS; i++) {
+        tasks_new(_contention_task, &contention_tasks[i], TASK_READY, "bench_contention");
+    }
+    for (size_t i = 0; i < CONTENTION_TASKS; i++) {
+        contention_done.Wait();
+    }
+    uint64_t elapsed = tasks_get_time() - start;
+    switches = this_cpu_read(nr_switches) - switches;
+
+    uint32_t expected = CONTENTION_TASKS * CONTENTION_ITERATIONS;
+    rs232::printf("mutex contention: %u tasks x %u locks in %u ms, %u switches%s\n",
+        CONTENTION_TASKS, CONTENTION_ITERATIONS, (uint32_t)(elapsed / 1000000), switches,
+        contention_counter == expected ? "" : " (COUNTER MISMATCH)");
+}
+
+#define UNCONTENDED_ITERATIONS  1000000
+
+static void bench_mutex_uncontended(void)
+{
+    Mutex mutex("bench_uncontended");
+    uint64_t start = tasks_get_time();
+    for (size_t i = 0; i < UNCONTENDED_ITERATIONS; i++) {
+        mutex.Lock();
+        mutex.Unlock();
+    }
+    uint64_t elapsed = tasks_get_time() - start;
+    if (elapsed == 0) elapsed = 1;
+
+    uint64_t per_sec = (UNCONTENDED_ITERATIONS * 1000000000ULL) / elapsed;
+    rs232::printf("mutex uncontended: %u lock/unlock pairs in %u us (%u pairs/s, %u ns each)\n",
+        UNCONTENDED_ITERATIONS, (uint32_t)(elapsed / 1000), (uint32_t)per_sec,
+        (uint32_t)(elapsed / UNCONTENDED_ITERATIONS));
+}
+
+// priority inversion scenario: a low priority task holds a mutex that a
+// high priority task needs while medium priority tasks hog the CPU
+#define INVERSION_MEDIUM_TASKS  2
+#define INVERSION_ROUNDS        50
+#define INVERSION_LOW_HOLD_NS   (1000ULL * 1000)
+#define INVERSION_MEDIUM_RUN_NS (20ULL * 1000 * 1000)
+#define INVERSION_MEDIUM_REST_NS (10ULL * 1000 * 1000)
+#define INVERSION_HIGH_PERIOD_NS (5ULL * 1000 * 1000)
+
+static Mutex *inversion_mutex;
+static volatile bool inversion_stop;
+static Semaphore inversion_done(0, false, "bench_inversion_done");
+static uint64_t inversion_worst;
+static uint64_t inversion_total;
+
+static void _busy(uint64_t ns)
+{
+    uint64_t start = tasks_get_time();
+    while (tasks_get_time() - start < ns) {
+        asm volatile("pause");
+    }
+}
+
+static void _inversion_low(void)
+{
+    while (!inversion_stop) {
+        inversion_mutex->Lock();
+        _busy(INVERSION_LOW_HOLD_NS);
+        inversion_mutex->Unlock();
+        tasks_nano_sleep(INVERSION_LOW_HOLD_NS);
+    }
+    inversion_done.Post();
+}
+
+static void _inversion_medium(void)
+{
+    while (!inversion_stop) {
+        _busy(INVERSION_MEDIUM_RUN_NS);
+        tasks_nano_sleep(INVERSION_MEDIUM_REST_NS);
+    }
+    inversion_done.Post();
+}
+
+static void _inversion_high(void)
+{
+    for (size_t i = 0; i < INVERSION_ROUNDS; i++) {
+        tasks_nano_sleep(INVERSION_HIGH_PERIOD_NS);
+        uint64_t start = tasks_get_time();
+        inversion_mutex->Lock();
+        uint64_t waited = tasks_get_time() - start;
+        inversion_mutex->Unlock();
+        inversion_total += waited;
+        if (waited > inversion_worst) inversion_worst = waited;
+    }
+    inversion_stop = true;
+    inversion_done.Post();
+}
+
+static void _inversion_spawn(void (*entry)(void), uint32_t priority, const char *name)
+{
+    // pooled tasks, as the previous run's may not have been reaped yet
+    // when the next one starts
+    task_t *task = tasks_new(entry, NULL, TASK_PAUSED, name);
+    tasks_set_priority(task, priority);
+    tasks_unblock(task);
+}
+
+static void bench_priority_inversion(bool inherit)
+{
+    Mutex mutex("bench_inversion", inherit);
+    inversion_mutex = &mutex;
+    inversion_stop = false;
+    inversion_worst = 0;
+    inversion_total = 0;
+
+    size_t count = 0;
+    _inversion_spawn(_inversion_low, TASK_PRIO_MIN + 1, "bench_low");
+    count++;
+    for (size_t i = 0; i < INVERSION_MEDIUM_TASKS; i++) {
+        _inversion_spawn(_inversion_medium, TASK_PRIO_DEFAULT + 1, "bench_medium");
+        count++;
+    }
+    _inversion_spawn(_inversion_high, TASK_PRIO_MAX, "bench_high");
+    count++;
+    for (size_t i = 0; i < count; i++) {
+        inversion_done.Wait();
+    }
+
+    rs232::printf("priority inversion (%s inheritance): worst wait %u us, average %u us\n",
+        inherit ? "with" : "without", (uint32_t)(inversion_worst / 1000),
+        (uint32_t)(inversion_total / INVERSION_ROUNDS / 1000));
+}
+
+// short-lived tasks spawned in batches, each one exiting right away
+#define SPAWN_BATCH     8
+#define SPAWN_ROUNDS    500
+
+static Semaphore spawn_done(0, false, "bench_spawn_done");
+
+static void _spawn_task(void)
+{
+    spawn_done.Post();
+}
+
+static void bench_spawn(void)
+{
+    task_pool_stats_t before = tasks_pool_stats();
+    uint64_t start = tasks_get_time();
+    for (size_t round = 0; round < SPAWN_ROUNDS; round++) {
+        for (size_t i = 0; i < SPAWN_BATCH; i++) {
+            tasks_new(_spawn_task, NULL, TASK_READY, "bench_spawn");
+        }
+        for (size_t i = 0; i < SPAWN_BATCH; i++) {
+            spawn_done.Wait();
+        }
+    }
+    uint64_t elapsed = tasks_get_time() - start;
+    if (elapsed == 0) elapsed = 1;
+    task_pool_stats_t after = tasks_pool_stats();
+
+    uint32_t spawns = SPAWN_BATCH * SPAWN_ROUNDS;
+    uint64_t per_sec = (spawns * 1000000000ULL) / elapsed;
+    rs232::printf("spawn+exit: %u tasks in %u us (%u/s), %u from the pool, %u allocated\n",
+        spawns, (uint32_t)(elapsed / 1000), (uint32_t)per_sec,
+        after.hits - before.hits, after.misses - before.misses);
+}
+
+// lightweight operations run as coroutines instead of tasks, each
+// sleeping a few times as if waiting for a device
+#define ASYNC_COROUTINES    1000
+#define ASYNC_ROUNDS        4
+#define ASYNC_SLEEP_NS      (1000ULL * 1000)
+
+static uint32_t async_remaining;
+static async_completion_t async_done;
+
+static Async<void> _async_op(void)
+{
+    for (size_t i = 0; i < ASYNC_ROUNDS; i++) {
+        co_await async_sleep(ASYNC_SLEEP_NS);
+    }
+    if (__atomic_sub_fetch(&async_remaining, 1, __ATOMIC_RELAXED) == 0) {
+        async_complete(&async_done);
+    }
+}
+
+static void bench_async(void)
+{
+    async_completion_init(&async_done);
+    async_remaining = ASYNC_COROUTINES;
+    async_stats_t before = async_get_stats();
+    uint64_t start = tasks_get_time();
+    for (size_t i = 0; i < ASYNC_COROUTINES; i++) {
+        if (async_spawn(_async_op()) != 0) {
+            rs232::printf("async: out of memory after %u coroutines\n", i);
+            return;
+        }
+    }
+    uint32_t peak_bytes = async_get_stats().frame_bytes - before.frame_bytes;
+    waitable_t *const done[] = { &async_done.waitable };
+    wait_any(done, 1, TASKS_NO_TIMEOUT);
+    uint64_t elapsed = tasks_get_time() - start;
+    async_stats_t after = async_get_stats();
+
+    rs232::printf("async: %u coroutines x %u sleeps in %u us, %u resumes, %u bytes per frame (%u KiB total)\n",
+        ASYNC_COROUTINES, ASYNC_ROUNDS, (uint32_t)(elapsed / 1000), after.resumes - before.resumes,
+        after.max_frame, peak_bytes / 1024);
+}
+
+// values passed from a producer task to the benchmark task, one at a
+// time and then in batches
+#define CHANNEL_ITEMS   100000
+#define CHANNEL_BATCH   32
+
+// channels can't be reopened once closed, so each run has its own.
+// They outlive the runs as the producer may still be in Close() when
+// the benchmark sees the channel closed.
+static Channel<uint32_t, 64> channel_single("bench_channel");
+static Channel<uint32_t, 64> channel_batch("bench_channel_batch");
+static Channel<uint32_t, 64> *channel;
+static bool channel_batched;
+
+static void _channel_producer(void)
+{
+    uint32_t values[CHANNEL_BATCH];
+    for (uint32_t i = 0; i < CHANNEL_ITEMS; i += CHANNEL_BATCH) {
+        for (uint32_t j = 0; j < CHANNEL_BATCH; j++) {
+            values[j] = i + j;
+        }
+        if (channel_batched) {
+            channel->SendBatch(values, CHANNEL_BATCH);
+        } else {
+            for (uint32_t j = 0; j < CHANNEL_BATCH; j++) {
+                channel->Send(values[j]);
+            }
+        }
+    }
+    channel->Close();
+}
+
+static void bench_channel(bool batched)
+{
+    channel = batched ? &channel_batch : &channel_single;
+    channel_batched = batched;
+    uint32_t values[CHANNEL_BATCH];
+    uint32_t received = 0;
+    uint32_t sum = 0;
+    uint32_t switches = this_cpu_read(nr_switches);
+    uint64_t start = tasks_get_time();
+    tasks_new(_channel_producer, NULL, TASK_READY, "bench_producer");
+    for (;;) {
+        int count;
+        if (batched) {
+            count = channel->ReceiveBatch(values, CHANNEL_BATCH);
+        } else {
+            count = channel->Receive(values) == 0 ? 1 : -1;
+        }
+        if (count < 0) break;
+        for (int i = 0; i < count; i++) {
+            sum += values[i];
+        }
+        received += count;
+    }
+    uint64_t elapsed = tasks_get_time() - start;
+    switches = this_cpu_read(nr_switches) - switches;
+
+    uint32_t expected = (uint32_t)(((uint64_t)CHANNEL_ITEMS * (CHANNEL_ITEMS - 1)) / 2);
+    rs232::printf("channel %s: %u values in %u us, %u switches%s\n",
+        batched ? "batched" : "single", received, (uint32_t)(elapsed / 1000), switches,
+        received == CHANNEL_ITEMS && sum == expected ? "" : " (DATA MISMATCH)");
+}
+
+void run_benchmarks(void)
+{
+    rs232::printf("running benchmarks\n");
+    bench_primes();
+    bench_mutex_uncontended();
+    bench_mutex_contention();
+    bench_priority_inversion(false);
+    bench_priority_inversion(true);
+    bench_spawn();
+    bench_async();
+    bench_channel(false);
+    bench_channel(true);
+    rs232::printf("benchmarks done\n");
+}
+
+}
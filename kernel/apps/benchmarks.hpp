@@ -0,0 +1,22 @@
+/**
+ * @file benchmarks.hpp
+ * @author Panix Contributors
+ * @brief Kernel benchmarks, built with `make benchmark`
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+namespace apps {
+
+/**
+ * @brief Runs every kernel benchmark and reports the
+ * results over serial.
+ *
+ */
+void run_benchmarks(void);
+
+}
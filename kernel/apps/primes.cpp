@@ -12,7 +12,10 @@
 
 #include <lib/bitset.hpp>
 #include <lib/stdio.hpp>
+#include <lib/channel.hpp>
 #include <sys/tasks.hpp>
+#include <sys/threadpool.hpp>
+#include <dev/serial/rs232.hpp>
 #include <apps/primes.hpp>
 
 namespace apps {
@@ -24,33 +27,120 @@ namespace apps {
 static size_t primes[PRIMES_SIZE];
 static Bitset map = Bitset(primes, sizeof(primes));
 
-static size_t prime_current;
+// numbers sieved by one parallel job. segments must cover whole words of
+// the bitmap so that no two jobs ever modify the same word.
+#define PRIME_SEGMENT_SIZE (32 * 1024)
+static_assert(PRIME_SEGMENT_SIZE % (sizeof(size_t) * CHAR_BIT) == 0,
+              "prime segments must be word aligned");
+static_assert(PRIME_MAX_SQRT % (sizeof(size_t) * CHAR_BIT) == 0,
+              "the first prime segment must be word aligned");
+#define PRIME_SEGMENTS ((PRIME_MAX - PRIME_MAX_SQRT + PRIME_SEGMENT_SIZE - 1) / PRIME_SEGMENT_SIZE)
+
+static size_t prime_segments_done;
+// percentages completed, sent to show_primes() which keeps the highest
+// (segments can finish out of order). Closed once the computation is done.
+static Channel<uint32_t, 16> prime_progress("primes");
 
 void find_primes(void)
 {
     for (size_t i = 0; i < PRIMES_SIZE; i++)
         primes[i] = SIZE_MAX;
 
-    for (prime_current = 2; prime_current < PRIME_MAX_SQRT; prime_current++) {
-        if (!map.Get(prime_current)) continue;
-        for (size_t j = prime_current * prime_current; j < PRIME_MAX; j += prime_current) {
+    for (size_t p = 2; p < PRIME_MAX_SQRT; p++) {
+        if (!map.Get(p)) continue;
+        for (size_t j = p * p; j < PRIME_MAX; j += p) {
             map.Clear(j);
         }
     }
 }
 
-void show_primes(void)
+static void _sieve_segment(size_t lo, size_t hi)
 {
-    do {
-        tasks_nano_sleep(1000ULL * 1000 * 1000);
-        size_t pct = (prime_current * 100) / PRIME_MAX_SQRT;
-        kprintf("\e[s\e[23;0fComputing primes: %%%u\e[u", pct);
-    } while (prime_current < PRIME_MAX_SQRT);
+    // cross off multiples of every base prime within [lo, hi)
+    for (size_t p = 2; p < PRIME_MAX_SQRT; p++) {
+        if (!map.Get(p)) continue;
+        size_t start = ((lo + p - 1) / p) * p;
+        if (start < p * p) start = p * p;
+        for (size_t j = start; j < hi; j += p) {
+            map.Clear(j);
+        }
+    }
+    size_t done = __atomic_add_fetch(&prime_segments_done, 1, __ATOMIC_RELAXED);
+    uint32_t pct = (done * 100) / PRIME_SEGMENTS;
+    // only bother the display when the percentage changes. Sieving
+    // doesn't wait for a display that falls behind, it will see a
+    // later percentage, or the channel closing at the end.
+    if (pct != ((done - 1) * 100) / PRIME_SEGMENTS) {
+        prime_progress.TrySend(pct);
+    }
+}
+
+void find_primes_parallel(void)
+{
+    prime_segments_done = 0;
+    for (size_t i = 0; i < PRIMES_SIZE; i++)
+        primes[i] = SIZE_MAX;
+
+    // sieve the base primes below PRIME_MAX_SQRT serially
+    for (size_t p = 2; p < PRIME_MAX_SQRT; p++) {
+        if (!map.Get(p)) continue;
+        for (size_t j = p * p; j < PRIME_MAX_SQRT; j += p) {
+            map.Clear(j);
+        }
+    }
+    // every segment above that only reads the base primes, so they can
+    // all be sieved independently
+    auto segment = [](size_t lo, size_t hi) { _sieve_segment(lo, hi); };
+    parallel_for(PRIME_MAX_SQRT, PRIME_MAX, PRIME_SEGMENT_SIZE, segment);
+    prime_progress.Close();
+}
 
+static size_t _count_primes(void)
+{
     size_t count = 0;
     for (size_t i = 2; i < PRIME_MAX; i++) {
         count += map.Get(i);
     }
+    return count;
+}
+
+void bench_primes(void)
+{
+    uint64_t start = tasks_get_time();
+    find_primes();
+    uint64_t serial = tasks_get_time() - start;
+    size_t serial_count = _count_primes();
+
+    start = tasks_get_time();
+    find_primes_parallel();
+    uint64_t parallel = tasks_get_time() - start;
+    size_t parallel_count = _count_primes();
+
+    rs232::printf("primes: serial %u primes in %u ms\n",
+        serial_count, (uint32_t)(serial / 1000000));
+    rs232::printf("primes: parallel (%u workers, %u segments) %u primes in %u ms\n",
+        threadpool_workers(), PRIME_SEGMENTS, parallel_count, (uint32_t)(parallel / 1000000));
+}
+
+void show_primes(void)
+{
+    uint32_t shown = 0;
+    kprintf("\e[s\e[23;0fComputing primes: %%%u\e[u", shown);
+    uint32_t updates[16];
+    int received;
+    // take everything sent since the last update at once
+    while ((received = prime_progress.ReceiveBatch(updates, 16)) > 0) {
+        uint32_t pct = shown;
+        for (int i = 0; i < received; i++) {
+            if (updates[i] > pct) pct = updates[i];
+        }
+        if (pct != shown) {
+            shown = pct;
+            kprintf("\e[s\e[23;0fComputing primes: %%%u\e[u", pct);
+        }
+    }
+
+    size_t count = _count_primes();
     kprintf("\e[s\e[23;0fFound %u primes between 2 and %u.\e[u", count, PRIME_MAX);
 }
 
@@ -18,8 +18,22 @@ namespace apps {
  */
 void find_primes(void);
 /**
- * @brief Starts a task to display number of primes
- * found by find_primes.
+ * @brief Finds the same primes as find_primes, but sieves
+ * fixed-size segments of the range in parallel on the
+ * kernel thread pool.
+ *
+ */
+void find_primes_parallel(void);
+/**
+ * @brief Times find_primes against find_primes_parallel and
+ * reports the results over serial.
+ *
+ */
+void bench_primes(void);
+/**
+ * @brief Displays the progress of find_primes_parallel as it
+ * is sent over a channel, then the number of primes found
+ * once the channel is closed.
  *
  */
 void show_primes(void);
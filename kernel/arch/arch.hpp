@@ -43,8 +43,12 @@ void parse_stivale2(void* info);
 // Shared library code for i386+ & amd64 family
 #include <cpuid.h>
 #include <arch/i386/gdt.hpp>
+#include <arch/i386/percpu.hpp>
 #include <arch/i386/idt.hpp>
+#include <arch/i386/irqsoff.hpp>
 #include <arch/i386/isr.hpp>
+#include <arch/i386/fpu.hpp>
+#include <arch/i386/idle.hpp>
 #include <arch/i386/timer.hpp>
 #include <arch/i386/ports.hpp>
 
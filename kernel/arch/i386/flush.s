@@ -24,7 +24,7 @@ gdt_flush:
     mov %ax, %es
     mov %ax, %fs
     mov %ax, %ss
-    mov %ax, %gs
+    mov %ax, %gs    # placeholder until percpu_init() loads the per-CPU segment
     # Do a long jump back and return
     ljmp $0x08, $.flush
 .flush:
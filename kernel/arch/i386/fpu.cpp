@@ -0,0 +1,208 @@
+/**
+ * @file fpu.cpp
+ * @author Panix Contributors
+ * @brief Per-task x87/SSE/AVX register state with lazy switching
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <arch/arch.hpp>
+#include <arch/i386/fpu.hpp>
+#include <sys/tasks.hpp>
+#include <sys/panic.hpp>
+#include <mem/heap.hpp>
+#include <lib/string.hpp>
+#include <lib/stdio.hpp>
+#include <dev/tty/tty.hpp>
+
+#define CR0_TS          (1U << 3)
+#define CR4_OSXSAVE     (1U << 18)
+#define CPUID_ECX_XSAVE (1U << 26)
+#define CPUID_ECX_AVX   (1U << 28)
+#define XCR0_X87        (1U << 0)
+#define XCR0_SSE        (1U << 1)
+#define XCR0_AVX        (1U << 2)
+#define MXCSR_DEFAULT   0x1F80
+
+static bool _use_xsave = false;
+static size_t _state_size = 512;
+// the state every task starts out with
+static uint8_t _initial_state[FPU_STATE_MAX] __attribute__((aligned(FPU_STATE_ALIGN)));
+
+static void _fpu_nm_handler(registers_t *regs);
+
+static inline uint32_t _read_cr0()
+{
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void _set_ts()
+{
+    asm volatile("mov %0, %%cr0" :: "r"(_read_cr0() | CR0_TS));
+}
+
+static inline void _clts()
+{
+    asm volatile("clts");
+}
+
+static inline void _save(void *area)
+{
+    if (_use_xsave) {
+        asm volatile("xsave (%0)" :: "r"(area), "a"(0xFFFFFFFF), "d"(0xFFFFFFFF) : "memory");
+    } else {
+        asm volatile("fxsave (%0)" :: "r"(area) : "memory");
+    }
+}
+
+static inline void _restore(const void *area)
+{
+    if (_use_xsave) {
+        asm volatile("xrstor (%0)" :: "r"(area), "a"(0xFFFFFFFF), "d"(0xFFFFFFFF) : "memory");
+    } else {
+        asm volatile("fxrstor (%0)" :: "r"(area) : "memory");
+    }
+}
+
+void fpu_init()
+{
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (ecx & CPUID_ECX_XSAVE) {
+        uint32_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_OSXSAVE));
+        // only enable the state components we know how to handle
+        uint32_t xcr0 = XCR0_X87 | XCR0_SSE;
+        if (ecx & CPUID_ECX_AVX) xcr0 |= XCR0_AVX;
+        asm volatile("xsetbv" :: "c"(0), "a"(xcr0), "d"(0));
+        // ask how big the save area is with those components enabled
+        __get_cpuid_count(0xD, 0, &eax, &ebx, &ecx, &edx);
+        if (ebx <= FPU_STATE_MAX) {
+            _use_xsave = true;
+            _state_size = ebx;
+        } else {
+            // not expected with only x87/SSE/AVX, but fall back just in case
+            asm volatile("xsetbv" :: "c"(0), "a"(XCR0_X87 | XCR0_SSE), "d"(0));
+        }
+        kprintf(DBG_INFO "FPU: XSAVE %s, %u byte state%s\n",
+            _use_xsave ? "enabled" : "disabled", _state_size,
+            (xcr0 & XCR0_AVX) ? ", AVX enabled" : "");
+    }
+    // capture a clean state for new tasks to start from
+    uint32_t mxcsr = MXCSR_DEFAULT;
+    _clts();
+    asm volatile("fninit");
+    asm volatile("ldmxcsr %0" :: "m"(mxcsr));
+    _save(_initial_state);
+    register_interrupt_handler(ISR_DEVICE_UNAVAIL, _fpu_nm_handler);
+    // nobody owns the registers yet, so the first use traps
+    this_cpu_write(fpu_owner, NULL);
+    _set_ts();
+}
+
+size_t fpu_state_size()
+{
+    return _state_size;
+}
+
+void fpu_task_init(struct task *task)
+{
+    task->fpu_alloc = malloc(_state_size + FPU_STATE_ALIGN - 1);
+    if (task->fpu_alloc == NULL) {
+        PANIC("Unable to allocate memory for task FPU state.\n");
+    }
+    uintptr_t area = ((uintptr_t)task->fpu_alloc + FPU_STATE_ALIGN - 1) & ~(uintptr_t)(FPU_STATE_ALIGN - 1);
+    task->fpu_state = (void *)area;
+    memcpy(task->fpu_state, _initial_state, _state_size);
+}
+
+void fpu_task_reset(struct task *task)
+{
+    uint32_t flags = interrupts_save();
+    // the registers may still hold whatever the last user left in them
+    if (this_cpu_read(fpu_owner) == task) {
+        this_cpu_write(fpu_owner, NULL);
+    }
+    interrupts_restore(flags);
+    memcpy(task->fpu_state, _initial_state, _state_size);
+}
+
+void fpu_task_free(struct task *task)
+{
+    uint32_t flags = interrupts_save();
+    // its registers don't need saving anymore
+    if (this_cpu_read(fpu_owner) == task) {
+        this_cpu_write(fpu_owner, NULL);
+    }
+    interrupts_restore(flags);
+    free(task->fpu_alloc);
+    task->fpu_alloc = NULL;
+    task->fpu_state = NULL;
+}
+
+void fpu_switch(struct task *next)
+{
+    bool owner = this_cpu_read(fpu_owner) == next;
+    bool ts = _read_cr0() & CR0_TS;
+    if (owner && ts) {
+        _clts();
+    } else if (!owner && !ts) {
+        _set_ts();
+    }
+}
+
+void fpu_irq_enter()
+{
+    // only the owner runs with TS clear (see fpu_switch())
+    if (!(_read_cr0() & CR0_TS)) {
+        _set_ts();
+    }
+}
+
+void fpu_irq_exit()
+{
+    // the handler may have taken the registers, in which case the task
+    // has to trap to get its state back
+    bool owner = this_cpu_read(fpu_owner) == this_cpu_read(current_task);
+    bool ts = _read_cr0() & CR0_TS;
+    if (owner && ts) {
+        _clts();
+    } else if (!owner && !ts) {
+        _set_ts();
+    }
+}
+
+static void _fpu_nm_handler(registers_t *regs)
+{
+    (void)regs;
+    _clts();
+    task_t *owner = this_cpu_read(fpu_owner);
+    if (this_cpu_read(preempt_count) & ~PREEMPT_MASK) {
+        // an interrupt handler wants the registers: save whoever's state
+        // is in them and let it have them until fpu_irq_exit()
+        if (owner != NULL) {
+            _save(owner->fpu_state);
+            this_cpu_write(fpu_owner, NULL);
+        }
+        return;
+    }
+    task_t *current = this_cpu_read(current_task);
+    if (owner == current) {
+        return;
+    }
+    // park the previous owner's registers in its save area
+    if (owner != NULL) {
+        _save(owner->fpu_state);
+    }
+    // and bring in ours (outside of any task, e.g. an interrupt while
+    // idling, the registers are simply left to whoever uses them)
+    if (current != NULL) {
+        _restore(current->fpu_state);
+    }
+    this_cpu_write(fpu_owner, current);
+}
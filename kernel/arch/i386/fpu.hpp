@@ -0,0 +1,79 @@
+/**
+ * @file fpu.hpp
+ * @author Panix Contributors
+ * @brief Per-task x87/SSE/AVX register state. Every task owns a save area,
+ * but registers are only saved and restored when a task that isn't the
+ * current owner actually touches them: switches set CR0.TS and the
+ * resulting #NM trap swaps the state in. Interrupt handlers run with
+ * CR0.TS set, so if they use the registers (the compiler emits SSE for
+ * copies) the interrupted task's state is saved first.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct task;
+
+// largest save area used (legacy area, XSAVE header and AVX state)
+#define FPU_STATE_MAX   1024
+#define FPU_STATE_ALIGN 64
+
+/**
+ * @brief Detects XSAVE and AVX, enables them if present and installs
+ * the #NM handler. Must be called after the ISRs are installed and
+ * before tasks_init().
+ *
+ */
+void fpu_init();
+/**
+ * @brief Returns the size of a task's save area in bytes.
+ *
+ * @return size_t Save area size
+ */
+size_t fpu_state_size();
+/**
+ * @brief Gives a new task a save area holding the clean initial state.
+ *
+ * @param task New task
+ */
+void fpu_task_init(struct task *task);
+/**
+ * @brief Resets the save area of a task that is being reused to the
+ * clean initial state.
+ *
+ * @param task Reused task
+ */
+void fpu_task_reset(struct task *task);
+/**
+ * @brief Releases a stopped task's save area.
+ *
+ * @param task Stopped task
+ */
+void fpu_task_free(struct task *task);
+/**
+ * @brief Called by the scheduler right before switching to a task.
+ * Traps its first use of the FPU unless it already owns the registers.
+ *
+ * @param next Task about to run
+ */
+void fpu_switch(struct task *next);
+/**
+ * @brief Called on entry to the outermost interrupt handler. Makes any
+ * use of the registers by the handler trap, so that a task's live state
+ * can be saved before it is clobbered.
+ *
+ */
+void fpu_irq_enter();
+/**
+ * @brief Called when the outermost interrupt handler is done, before
+ * the interrupted task is resumed or switched out. Lets the task use its
+ * registers without a trap again if the handler didn't touch them.
+ *
+ */
+void fpu_irq_exit();
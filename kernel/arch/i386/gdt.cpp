@@ -20,7 +20,7 @@ extern "C" void gdt_flush(uintptr_t);
 // Function declarations
 void gdt_set_gate(uint8_t num, uint64_t base, uint64_t limit, uint16_t flags);
 // Define our local variables
-gdt_entry_t gdt_entries[5];
+gdt_entry_t gdt_entries[GDT_ENTRIES];
 gdt_ptr_t   gdt_ptr;
 
 void gdt_set_gate(uint8_t num, uint64_t base, uint64_t limit, uint16_t flags) {
@@ -52,8 +52,9 @@ void gdt_set_gate(uint8_t num, uint64_t base, uint64_t limit, uint16_t flags) {
 
 //gdt_flush((uintptr_t)gdtp);
 void gdt_install() {
-    kprintf(DBG_INFO "Installing the GDT...\n");
-    gdt_ptr.limit = (sizeof(gdt_entry_t) * 5) - 1;
+    // Nothing may be printed until GS is loaded below since the print
+    // path reads the current task from the per-CPU segment.
+    gdt_ptr.limit = (sizeof(gdt_entry_t) * GDT_ENTRIES) - 1;
     gdt_ptr.base  = (uint32_t)&gdt_entries;
 
     gdt_set_gate(0, 0, 0, 0);                     // Null segment
@@ -61,7 +62,11 @@ void gdt_install() {
     gdt_set_gate(2, 0, 0x000FFFFF, GDT_DATA_PL0); // Kernel data segment
     gdt_set_gate(3, 0, 0x000FFFFF, GDT_CODE_PL3); // User mode code segment
     gdt_set_gate(4, 0, 0x000FFFFF, GDT_DATA_PL3); // User mode data segment
+    gdt_set_gate(5, 0, 0, 0);                     // Reserved for the TSS
+    gdt_set_gate(GDT_PERCPU_INDEX, (uint32_t)&cpu_boot_data,
+                 sizeof(cpu_local_t) - 1, GDT_PERCPU_PL0); // Per-CPU data segment
 
     gdt_flush((uint32_t)&gdt_ptr);
+    percpu_init();
     kprintf(DBG_OKAY "Installed the GDT.\n");
 }
\ No newline at end of file
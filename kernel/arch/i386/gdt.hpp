@@ -60,6 +60,16 @@
                      SEG_LONG(0) | SEG_SIZE(1) | SEG_GRAN(1) | \
                      SEG_PRIV(3) | SEG_DATA_RDWR
 
+// Byte granular so the limit covers exactly one per-CPU block
+#define GDT_PERCPU_PL0 SEG_TYPE(1) | SEG_PRES(1) | SEG_SAVL(0) | \
+                       SEG_LONG(0) | SEG_SIZE(1) | SEG_GRAN(0) | \
+                       SEG_PRIV(0) | SEG_DATA_RDWR
+
+// Entry 5 is left for the TSS (see tss_flush) and entry 6 holds the per-CPU segment
+#define GDT_ENTRIES         7
+#define GDT_PERCPU_INDEX    6
+#define GDT_PERCPU_SELECTOR (GDT_PERCPU_INDEX * 8)
+
 /**
  * @brief GDT Code & Data Segment Selector Struct
  *
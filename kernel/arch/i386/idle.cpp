@@ -0,0 +1,152 @@
+/**
+ * @file idle.cpp
+ * @author Panix Contributors
+ * @brief CPU idle states
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <arch/arch.hpp>
+#include <arch/i386/idle.hpp>
+#include <sys/tasks.hpp>
+#include <sys/hrtimer.hpp>
+#include <dev/serial/rs232.hpp>
+
+#define CPUID_ECX_MONITOR       (1U << 3)
+#define CPUID_MWAIT_ECX_EMX     (1U << 0)   // C-state sub-states are enumerated
+// deepest C-state MWAIT is asked for. Deeper states flush caches and
+// take far longer to leave, which would need ACPI to describe.
+#define IDLE_MWAIT_MAX_CSTATE   2
+
+// Exit latencies and target residencies are typical values, the
+// CPU doesn't report them without ACPI
+static idle_state_t _states[IDLE_STATES] = {
+    { "poll", 0, 0, true },
+    { "hlt", 2000, IDLE_POLL_WINDOW_NS, true },
+    { "mwait", 20000, 100000, false },
+};
+// EAX hint passed to MWAIT
+static uint32_t _mwait_hint = 0;
+
+void idle_init()
+{
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(ecx & CPUID_ECX_MONITOR) || !__get_cpuid(5, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+    // EDX has the number of sub-states of C0 to C7 in 4 bits each
+    uint32_t cstate = 1;
+    if (ecx & CPUID_MWAIT_ECX_EMX) {
+        for (uint32_t c = 2; c <= IDLE_MWAIT_MAX_CSTATE; c++) {
+            if ((edx >> (c * 4)) & 0xF) cstate = c;
+        }
+    }
+    // the hint is the C-state minus one in bits 7:4, sub-state 0
+    _mwait_hint = (cstate - 1) << 4;
+    if (cstate == 1) {
+        // no deeper than HLT, but it also wakes on need_resched
+        // being written, so it takes over from HLT
+        _states[IDLE_STATE_MWAIT].exit_latency_ns = _states[IDLE_STATE_HLT].exit_latency_ns;
+        _states[IDLE_STATE_MWAIT].target_residency_ns = _states[IDLE_STATE_HLT].target_residency_ns;
+    }
+    _states[IDLE_STATE_MWAIT].enabled = true;
+}
+
+static uint32_t _select(uint64_t predicted)
+{
+    // the deepest state that pays for itself within the idle period
+    uint32_t best = IDLE_STATE_POLL;
+    for (uint32_t i = IDLE_STATE_POLL + 1; i < IDLE_STATES; i++) {
+        if (_states[i].enabled && _states[i].target_residency_ns <= predicted) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void _poll(uint64_t until)
+{
+    interrupts_on();
+    while (!this_cpu_read(need_resched) && tasks_get_time() < until) {
+        asm volatile("pause");
+    }
+    interrupts_off();
+}
+
+static void _hlt()
+{
+    // STI only takes effect after the next instruction, so an interrupt
+    // can't slip in between the ready check and halting
+    irqsoff_stop(IRQSOFF_THIS_IP);
+    asm volatile("sti; hlt; cli" ::: "memory");
+    irqsoff_start(IRQSOFF_THIS_IP);
+}
+
+static void _mwait(cpu_local_t *cpu)
+{
+    asm volatile("monitor" :: "a"(&cpu->need_resched), "c"(0), "d"(0));
+    // a task made ready after the check still wakes us, since the
+    // write to the monitored line ends the MWAIT
+    if (!this_cpu_read(need_resched)) {
+        irqsoff_stop(IRQSOFF_THIS_IP);
+        asm volatile("sti; mwait; cli" :: "a"(_mwait_hint), "c"(0) : "memory");
+        irqsoff_start(IRQSOFF_THIS_IP);
+    }
+}
+
+void idle_enter()
+{
+    cpu_local_t *cpu = this_cpu();
+    // interrupts are disabled, so any task made ready from here on
+    // sets it again
+    this_cpu_write(need_resched, 0);
+    uint64_t start = tasks_get_time();
+    uint64_t next = hrtimer_next_expiry();
+    uint32_t state = _select(next > start ? next - start : 0);
+    switch (state) {
+        case IDLE_STATE_POLL:
+            _poll(start + IDLE_POLL_WINDOW_NS);
+            break;
+        case IDLE_STATE_HLT:
+            _hlt();
+            break;
+        case IDLE_STATE_MWAIT:
+            _mwait(cpu);
+            break;
+    }
+    cpu->idle_usage[state]++;
+    cpu->idle_residency[state] += tasks_get_time() - start;
+}
+
+const idle_state_t *idle_get_state(uint32_t id)
+{
+    return id < IDLE_STATES ? &_states[id] : NULL;
+}
+
+void idle_get_stats(idle_stats_t *stats)
+{
+    cpu_local_t *cpu = this_cpu();
+    uint32_t flags = interrupts_save();
+    stats->idle_time = cpu->idle_time;
+    for (size_t i = 0; i < IDLE_STATES; i++) {
+        stats->usage[i] = cpu->idle_usage[i];
+        stats->residency[i] = cpu->idle_residency[i];
+    }
+    interrupts_restore(flags);
+}
+
+void idle_dump()
+{
+    idle_stats_t stats;
+    idle_get_stats(&stats);
+    // idle <cpu> <total us>
+    rs232::printf("idle %u %u\n", this_cpu_read(id), (uint32_t)(stats.idle_time / 1000));
+    // cstate <cpu> <name> <enabled> <entries> <residency us>
+    for (size_t i = 0; i < IDLE_STATES; i++) {
+        rs232::printf("cstate %u %s %u %u %u\n", this_cpu_read(id), _states[i].name,
+            _states[i].enabled, stats.usage[i], (uint32_t)(stats.residency[i] / 1000));
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file idle.hpp
+ * @author Panix Contributors
+ * @brief CPU idle states. When there is nothing to run, the scheduler
+ * asks the idle driver to wait for the next task. The driver predicts
+ * how long the CPU will be idle from the next timer expiry and picks
+ * the deepest state worth entering for that long: spinning when a
+ * wakeup is imminent, HLT, or MWAIT with the deepest C-state hint the
+ * CPU reports.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/i386/percpu.hpp>
+
+// Wakeups expected within this many nanoseconds are waited for by
+// spinning, which wakes up faster than any halt state
+#define IDLE_POLL_WINDOW_NS     (20ULL * 1000)
+
+enum idle_state_id
+{
+    IDLE_STATE_POLL = 0,    // spin until a task is ready
+    IDLE_STATE_HLT,         // halt until the next interrupt
+    IDLE_STATE_MWAIT,       // MWAIT in a deeper C-state
+    IDLE_STATES,
+};
+static_assert(IDLE_STATES == CPU_IDLE_STATES, "percpu.hpp must have room for every idle state");
+
+typedef struct idle_state
+{
+    const char *name;
+    uint32_t exit_latency_ns;       // time it takes to wake up
+    uint32_t target_residency_ns;   // shortest idle period worth entering it for
+    bool enabled;
+} idle_state_t;
+
+typedef struct idle_stats
+{
+    uint64_t idle_time;                     // total nanoseconds spent idle
+    uint32_t usage[IDLE_STATES];            // times each state was entered
+    uint64_t residency[IDLE_STATES];        // nanoseconds spent in each state
+} idle_stats_t;
+
+/**
+ * @brief Detects which idle states the CPU supports.
+ *
+ */
+void idle_init();
+/**
+ * @brief Idles this CPU until a task may have become ready or the
+ * predicted idle period ends. Called by the scheduler with interrupts
+ * disabled, which they are again on return.
+ *
+ */
+void idle_enter();
+/**
+ * @brief Tells an idle CPU that a task became ready. Called with
+ * interrupts disabled whenever a task is made ready.
+ *
+ */
+static inline void idle_kick()
+{
+    this_cpu_write(need_resched, 1);
+}
+/**
+ * @brief Gets an idle state's description.
+ *
+ * @param id State to describe
+ * @return const idle_state_t* The state, or NULL if id is out of range
+ */
+const idle_state_t *idle_get_state(uint32_t id);
+/**
+ * @brief Gets this CPU's idle counters.
+ *
+ * @param stats Filled in with the counters
+ */
+void idle_get_stats(idle_stats_t *stats);
+/**
+ * @brief Prints this CPU's idle counters to serial.
+ *
+ */
+void idle_dump();
@@ -12,8 +12,7 @@ isr_common_stub:
     movw $0x10, %ax     # kernel data segment descriptor
     movw %ax, %ds
     movw %ax, %es
-    movw %ax, %fs
-    movw %ax, %gs
+    movw %ax, %fs       # GS holds the per-CPU segment and is left alone
     push %esp           # Push registers_t *r
     # 2. Clear the directory flag (eflags) & call C handler
     cld                 # C code following the sysV ABI requires DF to be clear on function entry
@@ -25,7 +24,6 @@ isr_common_stub:
     movw %ax, %ds
     movw %ax, %es
     movw %ax, %fs
-    movw %ax, %gs
     popal
     addl $8, %esp       # Cleans up the pushed error code and pushed ISR number
     iret                # pops 5 things at once: CS, EIP, EFLAGS, SS, and ESP
@@ -41,7 +39,6 @@ irq_common_stub:
     movw %ax, %ds
     movw %ax, %es
     movw %ax, %fs
-    movw %ax, %gs
     pushl %esp
     cld
     call irq_handler # Different than the ISR code
@@ -50,7 +47,6 @@ irq_common_stub:
     movw %bx, %ds
     movw %bx, %es
     movw %bx, %fs
-    movw %bx, %gs
     popal
     addl $8, %esp
     iret
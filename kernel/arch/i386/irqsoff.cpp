@@ -0,0 +1,151 @@
+/**
+ * @file irqsoff.cpp
+ * @author Panix Contributors
+ * @brief Interrupts-off and preemption-off latency tracer
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <arch/arch.hpp>
+#include <arch/i386/irqsoff.hpp>
+#include <sys/tasks.hpp>
+#include <dev/serial/rs232.hpp>
+#include <x86gprintrin.h>   // needed for __rdtsc
+
+typedef struct irqsoff_span
+{
+    uintptr_t start_ip;
+    uintptr_t stop_ip;
+    uint64_t max;           // TSC cycles
+    uint32_t count;
+} irqsoff_span_t;
+
+// only touched with interrupts disabled
+static irqsoff_span_t _top[IRQSOFF_KINDS][IRQSOFF_TOP];
+
+static const char *_kind_names[IRQSOFF_KINDS] = {
+    [IRQSOFF_IRQS] = "irqsoff",
+    [IRQSOFF_PREEMPT] = "preemptoff",
+};
+
+#ifdef IRQSOFF_TRACE
+static void _record(irqsoff_kind kind, uintptr_t start_ip, uintptr_t stop_ip, uint64_t cycles)
+{
+    irqsoff_span_t *top = _top[kind];
+    // the same pair of call sites only takes up one entry
+    irqsoff_span_t *least = &top[0];
+    for (size_t i = 0; i < IRQSOFF_TOP; i++) {
+        irqsoff_span_t *span = &top[i];
+        if (span->start_ip == start_ip && span->stop_ip == stop_ip) {
+            span->count++;
+            if (cycles > span->max) span->max = cycles;
+            return;
+        }
+        // unused entries have a max of 0, so they are taken first
+        if (span->max < least->max) least = span;
+    }
+    if (cycles > least->max) {
+        *least = {
+            .start_ip = start_ip,
+            .stop_ip = stop_ip,
+            .max = cycles,
+            .count = 1,
+        };
+    }
+}
+
+void irqsoff_start(uintptr_t ip)
+{
+    cpu_local_t *cpu = this_cpu();
+    if (cpu->irqsoff_ip != 0) {
+        return;
+    }
+    cpu->irqsoff_ip = ip;
+    cpu->irqsoff_tsc = __rdtsc();
+}
+
+void irqsoff_stop(uintptr_t ip)
+{
+    cpu_local_t *cpu = this_cpu();
+    if (cpu->irqsoff_ip == 0) {
+        return;
+    }
+    _record(IRQSOFF_IRQS, cpu->irqsoff_ip, ip, __rdtsc() - cpu->irqsoff_tsc);
+    cpu->irqsoff_ip = 0;
+}
+
+void preemptoff_start(uintptr_t ip)
+{
+    cpu_local_t *cpu = this_cpu();
+    cpu->preemptoff_tsc = __rdtsc();
+    cpu->preemptoff_ip = ip;
+}
+
+void preemptoff_stop(uintptr_t ip)
+{
+    cpu_local_t *cpu = this_cpu();
+    if (cpu->preemptoff_ip == 0) {
+        return;
+    }
+    _record(IRQSOFF_PREEMPT, cpu->preemptoff_ip, ip, __rdtsc() - cpu->preemptoff_tsc);
+    cpu->preemptoff_ip = 0;
+}
+#endif
+
+size_t irqsoff_get_top(irqsoff_kind kind, irqsoff_entry_t *entries, size_t max)
+{
+    irqsoff_span_t spans[IRQSOFF_TOP];
+    uint32_t flags = interrupts_save();
+    for (size_t i = 0; i < IRQSOFF_TOP; i++) {
+        spans[i] = _top[kind][i];
+    }
+    interrupts_restore(flags);
+    // a handful of entries, so a selection sort will do
+    size_t count = 0;
+    while (count < max) {
+        irqsoff_span_t *worst = NULL;
+        for (size_t i = 0; i < IRQSOFF_TOP; i++) {
+            if (spans[i].count != 0 && (worst == NULL || spans[i].max > worst->max)) {
+                worst = &spans[i];
+            }
+        }
+        if (worst == NULL) break;
+        entries[count++] = {
+            .start_ip = worst->start_ip,
+            .stop_ip = worst->stop_ip,
+            .max_ns = tasks_tsc_to_ns(worst->max),
+            .count = worst->count,
+        };
+        worst->count = 0;
+    }
+    return count;
+}
+
+void irqsoff_reset()
+{
+    uint32_t flags = interrupts_save();
+    for (size_t kind = 0; kind < IRQSOFF_KINDS; kind++) {
+        for (size_t i = 0; i < IRQSOFF_TOP; i++) {
+            _top[kind][i] = { };
+        }
+    }
+    interrupts_restore(flags);
+}
+
+void irqsoff_dump()
+{
+#ifndef IRQSOFF_TRACE
+    rs232::printf("irqsoff not traced, build with IRQSOFF_TRACE\n");
+#endif
+    for (size_t kind = 0; kind < IRQSOFF_KINDS; kind++) {
+        irqsoff_entry_t entries[IRQSOFF_TOP];
+        size_t count = irqsoff_get_top((irqsoff_kind)kind, entries, IRQSOFF_TOP);
+        for (size_t i = 0; i < count; i++) {
+            rs232::printf("%s %u %u 0x%08x 0x%08x\n", _kind_names[kind],
+                (uint32_t)entries[i].max_ns, entries[i].count,
+                entries[i].start_ip, entries[i].stop_ip);
+        }
+    }
+}
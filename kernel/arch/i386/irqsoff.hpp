@@ -0,0 +1,106 @@
+/**
+ * @file irqsoff.hpp
+ * @author Panix Contributors
+ * @brief Interrupts-off and preemption-off latency tracer. Every span in
+ * which interrupts (or preemption) were disabled is timed with the TSC
+ * from the instruction that disabled them to the one that enabled them
+ * again, and the worst spans are kept along with those two call sites.
+ * The hooks are only compiled in with IRQSOFF_TRACE defined (make trace),
+ * otherwise they cost nothing and the tables stay empty. Call sites are
+ * printed as addresses, which addr2line resolves against the kernel image.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// worst spans kept of each kind
+#define IRQSOFF_TOP 8
+
+/**
+ * @brief Address of the instruction it is used at. In an inline function
+ * that is the call site the function was inlined into. The asm is
+ * volatile so that uses within one function aren't merged into one.
+ *
+ */
+#define IRQSOFF_THIS_IP __extension__ ({                                \
+    uintptr_t __ip;                                                     \
+    asm volatile("movl $1f, %0\n1:" : "=r"(__ip));                      \
+    __ip; })
+
+enum irqsoff_kind
+{
+    IRQSOFF_IRQS = 0,   // interrupts disabled
+    IRQSOFF_PREEMPT,    // preemption disabled
+    IRQSOFF_KINDS
+};
+
+typedef struct irqsoff_entry
+{
+    uintptr_t start_ip;     // where the span started
+    uintptr_t stop_ip;      // where it ended
+    uint64_t max_ns;        // longest span between the two
+    uint32_t count;         // spans between the two since it was recorded
+} irqsoff_entry_t;
+
+#ifdef IRQSOFF_TRACE
+/**
+ * @brief Notes that interrupts were just disabled. Does nothing if they
+ * already were. Must be called with interrupts disabled.
+ *
+ * @param ip Call site that disabled them
+ */
+void irqsoff_start(uintptr_t ip);
+/**
+ * @brief Notes that interrupts are about to be enabled and records the
+ * span since they were disabled. Must be called with interrupts disabled.
+ *
+ * @param ip Call site that enables them
+ */
+void irqsoff_stop(uintptr_t ip);
+/**
+ * @brief Notes that a task disabled preemption.
+ *
+ * @param ip Call site that disabled it
+ */
+void preemptoff_start(uintptr_t ip);
+/**
+ * @brief Records the span since preemption was disabled. Must be called
+ * with interrupts disabled.
+ *
+ * @param ip Call site that enabled it again
+ */
+void preemptoff_stop(uintptr_t ip);
+#else
+static inline void irqsoff_start(uintptr_t) { }
+static inline void irqsoff_stop(uintptr_t) { }
+static inline void preemptoff_start(uintptr_t) { }
+static inline void preemptoff_stop(uintptr_t) { }
+#endif
+
+/**
+ * @brief Gets the worst spans recorded, longest first.
+ *
+ * @param kind Kind of span
+ * @param entries Array to copy them to
+ * @param max Size of the array
+ * @return size_t Number of entries copied
+ */
+size_t irqsoff_get_top(irqsoff_kind kind, irqsoff_entry_t *entries, size_t max);
+/**
+ * @brief Forgets all recorded spans.
+ *
+ */
+void irqsoff_reset();
+/**
+ * @brief Prints the worst spans to serial, one line per span, longest
+ * first: "irqsoff <ns> <count> <start ip> <stop ip>" for interrupts and
+ * "preemptoff ..." for preemption.
+ *
+ */
+void irqsoff_dump();
@@ -13,6 +13,7 @@
 #include <arch/arch.hpp>
 #include <lib/stdio.hpp>
 #include <dev/tty/tty.hpp>
+#include <sys/softirq.hpp>
 
 // Private array of interrupt handlers
 isr_t interrupt_handlers[256];
@@ -23,13 +24,16 @@ void (* isr_func_ptr[])(void) = { isr0,  isr1,  isr2,  isr3,  isr4,  isr5,  isr6
 void (* irq_func_ptr[])(void) = { irq0, irq1, irq2, irq3,   irq4,  irq5,  irq6,  irq7,
                                   irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15 };
 
+// Traced like interrupts_off() and interrupts_on(), but charged to the caller
 void interrupts_disable() {
     kprintf(DBG_WARN "Disabling interrupts\n");
-    asm volatile("cli");
+    asm volatile("cli" ::: "memory");
+    irqsoff_start((uintptr_t)__builtin_return_address(0));
 }
 void interrupts_enable() {
     kprintf(DBG_WARN "Enabling interrupts\n");
-    asm volatile("sti");
+    irqsoff_stop((uintptr_t)__builtin_return_address(0));
+    asm volatile("sti" ::: "memory");
 }
 
 /* Can't do this with a loop because we need the address
@@ -68,11 +72,22 @@ extern "C" void register_interrupt_handler(uint8_t n, isr_t handler) {
 }
 
 extern "C" void isr_handler(registers_t *r) {
+    // Some exceptions (like #NM for lazy FPU switching) are expected
+    if (interrupt_handlers[r->int_num] != 0) {
+        interrupt_handlers[r->int_num](r);
+        return;
+    }
     PANIC(r);
 }
 
 extern "C" void irq_handler(registers_t *regs) {
+    // interrupts are disabled from here until the IRET, which is
+    // charged to the handler
+    irqsoff_start(interrupt_handlers[regs->int_num] != 0 ?
+        (uintptr_t)interrupt_handlers[regs->int_num] : IRQSOFF_THIS_IP);
     set_indicator(VGA_Red);
+    irq_enter();
+    this_cpu_inc(nr_irqs);
     /* After every interrupt we need to send an EOI to the PICs
      * or they will not send another interrupt again */
     if (regs->int_num >= 40) {
@@ -86,5 +101,9 @@ extern "C" void irq_handler(registers_t *regs) {
         isr_t handler = interrupt_handlers[regs->int_num];
         handler(regs);
     }
+    /* Run any work the handler deferred now that the EOI has been sent,
+     * then switch tasks if the handler woke a more important one */
+    irq_exit();
     set_indicator(VGA_Green);
+    irqsoff_stop(IRQSOFF_THIS_IP);
 }
\ No newline at end of file
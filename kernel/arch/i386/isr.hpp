@@ -115,15 +115,68 @@ extern "C" void irq14();
 extern "C" void irq15();
 
 /**
- * @brief Disables interrupts.
+ * @brief Disables interrupts (and says so on the console). Traced like
+ * interrupts_off().
  *
  */
 void interrupts_disable();
 /**
- * @brief Enables interrupts.
+ * @brief Enables interrupts (and says so on the console). Traced like
+ * interrupts_on().
  *
  */
 void interrupts_enable();
+/**
+ * @brief Disables interrupts. Unlike interrupts_disable() this is meant
+ * for short critical sections and doesn't print anything. Traced (see
+ * irqsoff.hpp).
+ *
+ */
+static inline void interrupts_off()
+{
+    asm volatile("cli" ::: "memory");
+    irqsoff_start(IRQSOFF_THIS_IP);
+}
+/**
+ * @brief Enables interrupts at the end of a section started with
+ * interrupts_off().
+ *
+ */
+static inline void interrupts_on()
+{
+    irqsoff_stop(IRQSOFF_THIS_IP);
+    asm volatile("sti" ::: "memory");
+}
+/**
+ * @brief Disables interrupts and returns the previous EFLAGS value so
+ * that the interrupt state can be restored later.
+ *
+ * @return uint32_t Saved EFLAGS value
+ */
+static inline uint32_t interrupts_save()
+{
+    uint32_t flags;
+    asm volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    // EFLAGS.IF is bit 9
+    if (flags & (1 << 9)) {
+        irqsoff_start(IRQSOFF_THIS_IP);
+    }
+    return flags;
+}
+/**
+ * @brief Re-enables interrupts if they were enabled when the matching
+ * interrupts_save() was called.
+ *
+ * @param flags EFLAGS value returned by interrupts_save()
+ */
+static inline void interrupts_restore(uint32_t flags)
+{
+    // EFLAGS.IF is bit 9
+    if (flags & (1 << 9)) {
+        irqsoff_stop(IRQSOFF_THIS_IP);
+        asm volatile("sti" ::: "memory");
+    }
+}
 /**
  * @brief
  *
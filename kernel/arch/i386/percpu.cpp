@@ -0,0 +1,22 @@
+/**
+ * @file percpu.cpp
+ * @author Panix Contributors
+ * @brief Per-CPU data area setup
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <arch/arch.hpp>
+
+// There is only ever one CPU brought up for now
+cpu_local_t cpu_boot_data;
+
+void percpu_init() {
+    // The block is in the BSS, so everything else already starts out zeroed
+    cpu_boot_data.self = &cpu_boot_data;
+    cpu_boot_data.id = 0;
+    // Point GS at the segment describing this CPU's block
+    asm volatile("movw %0, %%gs" :: "r"((uint16_t)GDT_PERCPU_SELECTOR));
+}
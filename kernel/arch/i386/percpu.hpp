@@ -0,0 +1,159 @@
+/**
+ * @file percpu.hpp
+ * @author Panix Contributors
+ * @brief Per-CPU data area. Each CPU owns a cpu_local_t that is reached
+ * through a dedicated GDT data segment loaded into GS, so hot scheduler
+ * state can be read or written with a single segment-relative move.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct task;
+struct tasklet;
+struct rcu_head;
+
+// Number of idle states (see arch/i386/idle.hpp)
+#define CPU_IDLE_STATES 3
+
+/**
+ * @brief Per-CPU data block. The self pointer must remain the first
+ * member since this_cpu() loads it from GS:0, and the offset of
+ * current_task is hard-coded in tasks.S.
+ *
+ */
+typedef struct cpu_local
+{
+    struct cpu_local *self;         // Linear address of this block
+    uint32_t id;                    // Logical CPU number
+    struct task *current_task;      // Task running on this CPU (NULL while idle)
+    // Scheduler state
+    uint32_t sched_lock;            // Scheduler lock nesting depth
+    uint32_t preempt_count;         // Preemption disabled while non-zero (see preempt_disable())
+    uint32_t sched_postponed;       // A schedule was requested while preemption was disabled
+    uint64_t time_slice_remaining;  // Nanoseconds left in the current time slice
+    uint64_t last_time;             // Last time the running task was charged
+    uint64_t last_timer_time;       // Last time the time slice was decremented
+    uint64_t idle_time;             // Total nanoseconds spent idling
+    // Statistics
+    uint32_t nr_switches;           // Context switches performed
+    uint32_t nr_irqs;               // Hardware interrupts serviced
+    uint32_t nr_ticks;              // Timer ticks serviced
+    // Deferred work
+    uint32_t softirq_pending;       // Bitmask of raised softirqs
+    uint32_t softirq_active;        // Softirqs are being run on this CPU
+    struct tasklet *tasklet_head;   // Scheduled tasklets
+    struct tasklet *tasklet_tail;
+    // Read-copy-update
+    uint32_t rcu_qs_gp;             // Last grace period this CPU passed a quiescent state in
+    uint32_t rcu_wait_gp;           // Grace period the waiting callbacks need to see end
+    struct rcu_head *rcu_next_head; // Callbacks not yet waiting on a grace period
+    struct rcu_head *rcu_next_tail;
+    struct rcu_head *rcu_wait_head; // Callbacks waiting for rcu_wait_gp to end
+    struct rcu_head *rcu_wait_tail;
+    // FPU
+    struct task *fpu_owner;         // Task whose state is loaded in the FPU registers
+    // Idle
+    uint32_t need_resched;          // A task became ready, ends the idle state
+    uint32_t idle_usage[CPU_IDLE_STATES];       // Times each idle state was entered
+    uint64_t idle_residency[CPU_IDLE_STATES];   // Nanoseconds spent in each idle state
+    // Interrupt latency (in TSC cycles)
+    uint64_t sched_lock_tsc;        // When interrupts were disabled for the scheduler lock
+    uint64_t sched_lock_max;        // Longest the scheduler lock kept interrupts disabled
+    uint64_t hardirq_tsc;           // When the outermost hardware interrupt started
+    uint64_t hardirq_max;           // Longest hardware interrupt handler
+    // Latency tracer (see arch/i386/irqsoff.hpp)
+    uintptr_t irqsoff_ip;           // Where interrupts were disabled, 0 if they aren't
+    uint64_t irqsoff_tsc;           // When they were disabled
+    uintptr_t preemptoff_ip;        // Where preemption was disabled, 0 if it isn't
+    uint64_t preemptoff_tsc;        // When it was disabled
+} cpu_local_t;
+
+// Keep in sync with CPU_CURRENT_TASK in tasks.S (the host unit tests see
+// this header too, but with 64-bit pointers)
+static_assert(offsetof(cpu_local_t, self) == 0, "cpu_local_t::self must be at GS:0");
+#ifndef TESTING
+static_assert(offsetof(cpu_local_t, current_task) == 8, "tasks.S expects current_task at GS:8");
+#endif
+
+/**
+ * @brief The boot CPU's data block. Only reference this directly when
+ * setting up the segment; everything else should go through this_cpu().
+ *
+ */
+extern cpu_local_t cpu_boot_data;
+
+/**
+ * @brief Initializes the boot CPU's data block and loads its segment
+ * selector into GS. Must be called after the GDT has been flushed.
+ *
+ */
+void percpu_init();
+
+/**
+ * @brief Returns a pointer to the calling CPU's data block.
+ *
+ * @return cpu_local_t* Per-CPU data block
+ */
+static inline cpu_local_t *this_cpu()
+{
+    cpu_local_t *cpu;
+    asm("movl %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+/**
+ * @brief Reads a (32-bit or smaller) per-CPU field with a single GS-relative load.
+ *
+ */
+#define this_cpu_read(field) __extension__ ({                                       \
+    __typeof__(((cpu_local_t *)0)->field) __pcpu_ret;                               \
+    static_assert(sizeof(__pcpu_ret) <= sizeof(uint32_t), "field is too wide");     \
+    asm volatile("mov %%gs:%c1, %0"                                                 \
+                 : "=q"(__pcpu_ret) : "i"(offsetof(cpu_local_t, field)));           \
+    __pcpu_ret; })
+
+/**
+ * @brief Writes a (32-bit or smaller) per-CPU field with a single GS-relative store.
+ *
+ */
+#define this_cpu_write(field, val) do {                                             \
+    __typeof__(((cpu_local_t *)0)->field) __pcpu_val = (val);                       \
+    static_assert(sizeof(__pcpu_val) <= sizeof(uint32_t), "field is too wide");     \
+    asm volatile("mov %0, %%gs:%c1"                                                 \
+                 :: "q"(__pcpu_val), "i"(offsetof(cpu_local_t, field)) : "memory"); \
+} while (0)
+
+/**
+ * @brief Increments or decrements a 32-bit per-CPU counter in place.
+ *
+ */
+#define this_cpu_inc(field) do {                                                    \
+    static_assert(sizeof(((cpu_local_t *)0)->field) == sizeof(uint32_t), "field must be 32-bit"); \
+    asm volatile("incl %%gs:%c0" :: "i"(offsetof(cpu_local_t, field)) : "memory");  \
+} while (0)
+#define this_cpu_dec(field) do {                                                    \
+    static_assert(sizeof(((cpu_local_t *)0)->field) == sizeof(uint32_t), "field must be 32-bit"); \
+    asm volatile("decl %%gs:%c0" :: "i"(offsetof(cpu_local_t, field)) : "memory");  \
+} while (0)
+
+/**
+ * @brief Adds to or subtracts from a 32-bit per-CPU counter in place.
+ *
+ */
+#define this_cpu_add(field, val) do {                                               \
+    static_assert(sizeof(((cpu_local_t *)0)->field) == sizeof(uint32_t), "field must be 32-bit"); \
+    asm volatile("addl %0, %%gs:%c1"                                                \
+                 :: "ri"((uint32_t)(val)), "i"(offsetof(cpu_local_t, field)) : "memory"); \
+} while (0)
+#define this_cpu_sub(field, val) do {                                               \
+    static_assert(sizeof(((cpu_local_t *)0)->field) == sizeof(uint32_t), "field must be 32-bit"); \
+    asm volatile("subl %0, %%gs:%c1"                                                \
+                 :: "ri"((uint32_t)(val)), "i"(offsetof(cpu_local_t, field)) : "memory"); \
+} while (0)
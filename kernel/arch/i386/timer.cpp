@@ -15,43 +15,99 @@
 #include <dev/tty/tty.hpp>
 
 static void timer_callback(registers_t *regs);
+static void _pit_tick(clock_event_device_t *dev);
+static void _pit_set_periodic(clock_event_device_t *dev, uint64_t period_ns);
+static void _pit_set_next_event(clock_event_device_t *dev, uint64_t delta_ns);
 volatile uint32_t timer_tick;
 
-typedef void (*voidfunc_t)();
+static uint64_t _period_ns;
+static clock_event_device_t *_clockevents = NULL;
 
-#define MAX_CALLBACKS 8
-static size_t _callback_count = 0;
-static voidfunc_t _callbacks[MAX_CALLBACKS];
+// the PIT counts down from at most 0xffff, and an initial count
+// of one never fires in one-shot mode
+#define PIT_MIN_COUNT   2
+#define PIT_MAX_COUNT   0xffff
+#define PIT_NS(count)   (((count) * 1000000000ULL) / TIMER_PIT_HZ)
 
-/**
- * Sleep Timer Non-Busy Waiting Idea:
- * Create a struct that contains the end time and the callback
- * function pointer that should be called when timer_tick = end
- * After each timer_tick we check our end time and call the function
- * if we're equal.
- */
+static clock_event_device_t _pit = {
+    .name = "pit",
+    .features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT,
+    .rating = 100,
+    .min_delta_ns = PIT_NS(PIT_MIN_COUNT),
+    .max_delta_ns = PIT_NS(PIT_MAX_COUNT),
+    .set_periodic = _pit_set_periodic,
+    .set_next_event = _pit_set_next_event,
+    .event_handler = _pit_tick,
+    .next = NULL,
+};
 
 void timer_init(uint32_t freq) {
     kprintf(DBG_INFO "Initializing timer\n");
     /* Install the function we just wrote */
     register_interrupt_handler(IRQ0, timer_callback);
-    /* Get the PIT value: hardware clock at 1193180 Hz */
-    uint32_t divisor = 1193180 / freq;
+    /* Tick at the requested rate until the hrtimer code takes over */
+    _period_ns = 1000000000ULL / freq;
+    _pit_set_periodic(&_pit, _period_ns);
+    clockevents_register(&_pit);
+    kprintf(DBG_OKAY "Started timer\n");
+}
+
+static void _pit_set_periodic(clock_event_device_t *dev, uint64_t period_ns) {
+    (void)dev;
+    /* Get the PIT value: hardware clock at 1193182 Hz */
+    uint32_t divisor = (uint32_t)((period_ns * TIMER_PIT_HZ) / 1000000000ULL);
     uint8_t low  = (uint8_t)(divisor & 0xFF);
     uint8_t high = (uint8_t)((divisor >> 8) & 0xFF);
-    /* Send the command */
+    /* Send the command (channel 0, lo/hi byte, square wave) */
     writeByte(TIMER_COMMAND_PORT, 0x36);
     writeByte(TIMER_DATA_PORT, low);
     writeByte(TIMER_DATA_PORT, high);
-    kprintf(DBG_OKAY "Started timer\n");
+}
+
+static void _pit_set_next_event(clock_event_device_t *dev, uint64_t delta_ns) {
+    (void)dev;
+    uint64_t count = (delta_ns * TIMER_PIT_HZ) / 1000000000ULL;
+    if (count < PIT_MIN_COUNT) count = PIT_MIN_COUNT;
+    if (count > PIT_MAX_COUNT) count = PIT_MAX_COUNT;
+    /* Channel 0, lo/hi byte, interrupt on terminal count */
+    writeByte(TIMER_COMMAND_PORT, 0x30);
+    writeByte(TIMER_DATA_PORT, (uint8_t)(count & 0xFF));
+    writeByte(TIMER_DATA_PORT, (uint8_t)((count >> 8) & 0xFF));
+}
+
+static void _pit_tick(clock_event_device_t *dev) {
+    (void)dev;
+    timer_do_tick();
 }
 
 static void timer_callback(registers_t *regs) {
     (void)regs;
-    timer_tick++;
-    for (size_t i = 0; i < _callback_count; i++) {
-        _callbacks[i]();
+    _pit.event_handler(&_pit);
+}
+
+void timer_do_tick() {
+    // only ever written here, so no read-modify-write race
+    timer_tick = timer_tick + 1;
+    this_cpu_inc(nr_ticks);
+}
+
+uint64_t timer_period_ns() {
+    return _period_ns;
+}
+
+void clockevents_register(clock_event_device_t *dev) {
+    uint32_t flags = interrupts_save();
+    dev->next = _clockevents;
+    _clockevents = dev;
+    interrupts_restore(flags);
+}
+
+clock_event_device_t *clockevents_best() {
+    clock_event_device_t *best = NULL;
+    for (clock_event_device_t *dev = _clockevents; dev != NULL; dev = dev->next) {
+        if (best == NULL || dev->rating > best->rating) best = dev;
     }
+    return best;
 }
 
 void timer_print() {
@@ -66,10 +122,3 @@ void sleep(uint32_t ms) {
     // Return now that we've waited long enough
     return;
 }
-
-void timer_register_callback(void (*func)()) {
-    if (_callback_count < MAX_CALLBACKS - 1) {
-        _callbacks[_callback_count] = func;
-        _callback_count++;
-    }
-}
@@ -14,15 +14,67 @@
 
 #define TIMER_COMMAND_PORT 0x43
 #define TIMER_DATA_PORT 0x40
+#define TIMER_PIT_HZ    1193182
 
 extern volatile uint32_t timer_tick;
 
+#define CLOCK_EVT_FEAT_PERIODIC 0x1 // can interrupt at a fixed rate
+#define CLOCK_EVT_FEAT_ONESHOT  0x2 // can interrupt once after a given delay
+
+/**
+ * @brief A device that raises timer interrupts (a clock event device).
+ * Drivers register theirs with clockevents_register() and the hrtimer
+ * code drives the best one, preferably in one-shot mode.
+ *
+ */
+typedef struct clock_event_device clock_event_device_t;
+struct clock_event_device
+{
+    const char *name;
+    uint32_t features;      // CLOCK_EVT_FEAT_*
+    uint32_t rating;        // higher is better
+    uint64_t min_delta_ns;  // shortest delay set_next_event() can do
+    uint64_t max_delta_ns;  // longest delay set_next_event() can do
+    // interrupt every period_ns from now on
+    void (*set_periodic)(clock_event_device_t *dev, uint64_t period_ns);
+    // interrupt once, delta_ns from now (min_delta_ns <= delta_ns <= max_delta_ns)
+    void (*set_next_event)(clock_event_device_t *dev, uint64_t delta_ns);
+    // called from the interrupt handler
+    void (*event_handler)(clock_event_device_t *dev);
+    clock_event_device_t *next;
+};
+
 /**
  * @brief Initialize the CPU timer with the given frequency.
  *
  * @param freq Timer frequency
  */
 void timer_init(uint32_t freq);
+/**
+ * @brief Returns the tick period the timer was initialized with.
+ *
+ * @return uint64_t Nanoseconds between two ticks
+ */
+uint64_t timer_period_ns();
+/**
+ * @brief Advances the tick count. Called on every periodic interrupt
+ * until the hrtimer code takes over the clock event device, and by its
+ * tick timer after that.
+ *
+ */
+void timer_do_tick();
+/**
+ * @brief Registers a clock event device.
+ *
+ * @param dev Device to register
+ */
+void clockevents_register(clock_event_device_t *dev);
+/**
+ * @brief Returns the registered clock event device with the highest rating.
+ *
+ * @return clock_event_device_t* Best device, or NULL if there is none
+ */
+clock_event_device_t *clockevents_best();
 /**
  * @brief Prints out the current tick.
  *
@@ -34,5 +86,3 @@ void timer_print();
  * @param ms Sleep length in milliseconds
  */
 void sleep(uint32_t ms);
-
-void timer_register_callback(void (*func)());
@@ -14,11 +14,16 @@
 #include <dev/rtc/rtc.hpp>
 #include <lib/string.hpp>
 #include <lib/stdio.hpp>
+#include <lib/seqlock.hpp>
+#include <sys/workqueue.hpp>
 
 void rtc_callback(registers_t *regs);
 bool rtc_get_update_in_progress();
 uint8_t rtc_get_register(uint8_t reg);
 void read_rtc();
+static void rtc_work_func(void *data);
+
+static work_t rtc_work;
 
 // Current values from RTC
 // These variables are way larger than they ever
@@ -33,6 +38,10 @@ uint32_t rtc_month;       // Current UTC month
 uint32_t rtc_year;        // Current UTC year
 uint32_t rtc_century;     // Current UTC century
 
+// The last complete reading, published for lock-free readers
+static rtc_time_t rtc_time;
+static Seqlock rtc_time_lock;
+
 void rtc_init() {
     kprintf(DBG_INFO "Initializing RTC...\n");
     // Initializer
@@ -44,11 +53,19 @@ void rtc_init() {
     writeByte(RTC_CMOS_PORT, 0x8B);
     writeByte(RTC_DATA_PORT, (prev | 0x40));
     // Register our callback function with IRQ 8
+    work_init(&rtc_work, rtc_work_func, NULL);
     register_interrupt_handler(IRQ8, rtc_callback);
 }
 
 void rtc_callback(registers_t *regs) {
     (void)regs;
+    // Printing takes the screen lock, so leave it to the worker
+    schedule_work(&rtc_work);
+}
+
+static void rtc_work_func(void *data) {
+    (void)data;
+    read_rtc();
     kprintf(DBG_INFO "RTC updated.\n");
 }
 
@@ -142,17 +159,42 @@ void read_rtc() {
         rtc_year += (RTC_CURRENT_YEAR / 100) * 100;
         if(rtc_year < RTC_CURRENT_YEAR) rtc_year += 100;
     }
+
+    // Publish the new time. Readers may run in interrupt context,
+    // so they must not be able to interrupt the write.
+    uint32_t flags = interrupts_save();
+    rtc_time_lock.WriteBegin();
+    rtc_time = {
+        .second = rtc_second,
+        .minute = rtc_minute,
+        .hour = rtc_hour,
+        .day = rtc_day,
+        .month = rtc_month,
+        .year = rtc_year,
+    };
+    rtc_time_lock.WriteEnd();
+    interrupts_restore(flags);
+}
+
+void rtc_get_time(rtc_time_t *time) {
+    uint32_t seq;
+    do {
+        seq = rtc_time_lock.ReadBegin();
+        *time = rtc_time;
+    } while (rtc_time_lock.ReadRetry(seq));
 }
 
 void rtc_print() {
     read_rtc();
+    rtc_time_t time;
+    rtc_get_time(&time);
     kprintf(
         DBG_INFO
         "UTC: %i/%i/%i %i:%i\n",
-        rtc_month,
-        rtc_day,
-        rtc_year,
-        rtc_hour,
-        rtc_minute
+        time.month,
+        time.day,
+        time.year,
+        time.hour,
+        time.minute
     );
 }
@@ -24,12 +24,30 @@ extern uint32_t rtc_day;    // Current UTC day (not reliable)
 extern uint32_t rtc_month;  // Current UTC month
 extern uint32_t rtc_year;  // Current UTC year
 
+typedef struct rtc_time
+{
+    uint32_t second;
+    uint32_t minute;
+    uint32_t hour;
+    uint32_t day;
+    uint32_t month;
+    uint32_t year;
+} rtc_time_t;
+
 /**
  * @brief Initializes the Real Time Clock driver
  * for the x86_64 architecture.
  *
  */
 void rtc_init();
+/**
+ * @brief Gets a consistent copy of the time last read from
+ * the Real Time Clock. Never blocks, so it is safe to call
+ * from any context.
+ *
+ * @param time Where to store the time
+ */
+void rtc_get_time(rtc_time_t *time);
 /**
  * @brief Prints the current time as specified by
  * the platforms Real Time Clock.
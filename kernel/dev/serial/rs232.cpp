@@ -17,9 +17,10 @@
 #include <dev/serial/rs232.hpp>
 #include <mem/heap.hpp>
 #include <lib/stdio.hpp>
-#include <lib/mutex.hpp>
+#include <lib/spinlock.hpp>
 #include <lib/string.hpp>
 #include <lib/RingBuffer.hpp>
+#include <sys/workqueue.hpp>
 
 #define RS_232_COM1_IRQ 0x04
 #define RS_232_COM3_IRQ 0x04
@@ -39,12 +40,24 @@ namespace rs232 {
 
 static uint16_t rs_232_port_base;
 static RingBuffer<char, 1024> ring;
-static Mutex mutex_rs232("rs232");
+static spinlock_class_t rs232_locks = SPINLOCK_CLASS_INIT("rs232");
+// Protects the input ring
+static TicketLock ring_lock(&rs232_locks);
+// Bytes received by the IRQ handler that haven't been processed yet.
+// Shared with the IRQ handler, so the worker takes the lock with
+// interrupts disabled.
+static RingBuffer<char, 64> rx_pending;
+static TicketLock rx_lock(&rs232_locks);
+static work_t rx_work;
+// Ready while the ring has input for read()
+static waitable_t rx_ready;
 
 static int received();
 static int is_transmit_empty();
 static char read_byte();
 static void callback(registers_t *regs);
+static void rx_work_func(void *data);
+static bool rx_has_input(void *owner);
 
 static int received() {
     return readByte(rs_232_port_base + RS_232_LINE_STATUS_REG) & 1;
@@ -55,9 +68,7 @@ static int is_transmit_empty() {
 }
 
 static char read_byte() {
-    mutex_rs232.Lock();
     while (received() == 0);
-    mutex_rs232.Unlock();
     return readByte(rs_232_port_base + RS_232_DATA_REG);
 }
 
@@ -90,24 +101,54 @@ int printf(const char *format, ...)
 
 static void callback(registers_t *regs) {
     (void)regs;
-    // Grab the input character
-    char in = read_byte();
-    // Change carriage returns to newlines
-    if (in == '\r') {
-        in = '\n';
+    // Only drain the UART here, everything else is deferred to the
+    // worker since echoing and buffering need to take locks.
+    rx_lock.Lock();
+    while (received()) {
+        rx_pending.Enqueue(read_byte());
     }
-    // Create a string and print it so that the
-    // user can see what they're typing.
-    char str[2] = {in, '\0'};
-    printf("%s", str);
-    // Add the character to the circular buffer
-    ring.Enqueue(in);
+    rx_lock.Unlock();
+    schedule_work(&rx_work);
+}
+
+static void rx_work_func(void *data) {
+    (void)data;
+    for (;;) {
+        char in;
+        uint32_t flags = rx_lock.LockIrqSave();
+        int status = rx_pending.Dequeue(&in);
+        rx_lock.UnlockIrqRestore(flags);
+        if (status != 0) {
+            break;
+        }
+        // Change carriage returns to newlines
+        if (in == '\r') {
+            in = '\n';
+        }
+        // Create a string and print it so that the
+        // user can see what they're typing.
+        char str[2] = {in, '\0'};
+        printf("%s", str);
+        // Add the character to the circular buffer
+        ring_lock.Lock();
+        ring.Enqueue(in);
+        ring_lock.Unlock();
+        waitable_notify(&rx_ready);
+    }
+}
+
+static bool rx_has_input(void *owner) {
+    (void)owner;
+    // Only a hint, read() takes the lock to get at the input
+    return !ring.IsEmpty();
 }
 
 // FIXME: Use separate ring buffers for COM1 & COM2
 void init(uint16_t com_id) {
     // Register the IRQ callback
     rs_232_port_base = com_id;
+    work_init(&rx_work, rx_work_func, NULL);
+    waitable_init(&rx_ready, rx_has_input, NULL);
     uint8_t IRQ = 0x20 + (com_id == RS_232_COM1 ? RS_232_COM1_IRQ : RS_232_COM2_IRQ);
     register_interrupt_handler(IRQ, callback);
     // Write the port data to activate the device
@@ -135,13 +176,13 @@ void init(uint16_t com_id) {
 
 size_t read(char* buf, size_t count) {
     size_t bytes = 0;
-    mutex_rs232.Lock();
+    ring_lock.Lock();
     for (size_t idx = 0; idx < count && !ring.IsEmpty(); idx++)
     {
         buf[idx] = ring.Dequeue();
         bytes++;
     }
-    mutex_rs232.Unlock();
+    ring_lock.Unlock();
     return bytes;
 }
 
@@ -160,4 +201,8 @@ int close() {
     return 0;
 }
 
+waitable_t* rx_waitable() {
+    return &rx_ready;
+}
+
 };
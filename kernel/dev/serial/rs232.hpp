@@ -13,6 +13,7 @@
 
 #include <stdarg.h>
 #include <stdint.h>
+#include <sys/waitable.hpp>
 
 #define RS_232_COM1 0x3F8
 #define RS_232_COM2 0x2F8
@@ -73,4 +74,12 @@ int vprintf(const char* fmt, va_list args);
  */
 int close();
 
+/**
+ * @brief Gets the waitable for received input, for use with wait_any().
+ * It is ready while read() has bytes to return.
+ *
+ * @return waitable_t* Waitable for received input
+ */
+waitable_t* rx_waitable();
+
 };
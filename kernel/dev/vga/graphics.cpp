@@ -24,6 +24,7 @@
 #include <lib/assert.hpp>
 #include <lib/stdio.hpp>
 #include <lib/string.hpp>
+#include <lib/rwlock.hpp>
 // Bootloader
 #include <boot/Handoff.hpp>
 // Debug
@@ -31,7 +32,10 @@
 
 namespace fb {
 
-FramebufferInfo fbInfo;
+// Only read through getInfo()
+static FramebufferInfo fbInfo;
+// Guards fbInfo, which is read far more often than it changes
+static RWLock fbInfoLock("fbInfo");
 // Cached values
 static void* addr = NULL;
 static void* backbuffer = NULL;
@@ -50,6 +54,14 @@ static bool initialized = false;
 
 bool isInitialized() { return initialized; }
 
+FramebufferInfo getInfo()
+{
+    fbInfoLock.ReadLock();
+    FramebufferInfo info = fbInfo;
+    fbInfoLock.ReadUnlock();
+    return info;
+}
+
 static void testPattern() {
     const uint32_t BAR_COLOR[8] =
     {
@@ -80,22 +92,25 @@ static void testPattern() {
 
 void init(FramebufferInfo info)
 {
+    fbInfoLock.WriteLock();
     fbInfo = info;
+    fbInfoLock.WriteUnlock();
     // Ensure valid info is provided
-    if (fbInfo.getAddress() == NULL) { return; }
+    if (info.getAddress() == NULL) { return; }
     // Cache framebuffer values in order to avoid
-    // function calls when plotting pixels.
-    addr = fbInfo.getAddress();
-    width = fbInfo.getWidth();
-    height = fbInfo.getHeight();
-    depth = fbInfo.getDepth();
-    pitch = fbInfo.getPitch();
-    r_size = fbInfo.getRedMaskSize();
-    r_shift = fbInfo.getRedMaskShift();
-    g_size = fbInfo.getGreenMaskSize();
-    g_shift = fbInfo.getGreenMaskShift();
-    b_size = fbInfo.getBlueMaskSize();
-    b_shift = fbInfo.getBlueMaskShift();
+    // function calls when plotting pixels. They come from
+    // our own copy, everyone else goes through getInfo().
+    addr = info.getAddress();
+    width = info.getWidth();
+    height = info.getHeight();
+    depth = info.getDepth();
+    pitch = info.getPitch();
+    r_size = info.getRedMaskSize();
+    r_shift = info.getRedMaskShift();
+    g_size = info.getGreenMaskSize();
+    g_shift = info.getGreenMaskShift();
+    b_size = info.getBlueMaskSize();
+    b_shift = info.getBlueMaskShift();
     pixelwidth = (depth / 8);
     // Map in the framebuffer
     rs232::printf("Mapping framebuffer...\n");
@@ -25,6 +25,13 @@ namespace fb {
  */
 bool isInitialized();
 
+/**
+ * @brief Gets a copy of the current framebuffer information
+ *
+ * @return FramebufferInfo Framebuffer information
+ */
+FramebufferInfo getInfo();
+
 /**
  * @brief Initializes the framebuffer (if it exists)
  *
@@ -0,0 +1,293 @@
+/**
+ * @file channel.hpp
+ * @author Panix Contributors
+ * @brief Bounded channels for passing values between tasks. A
+ * Channel<T, N> buffers up to N values; senders block while it is full
+ * and receivers while it is empty, on the scheduler's wait queues, so a
+ * producer/consumer pipeline moves data without polling. Every value
+ * sent wakes at most one receiver. Close() ends the stream: receivers
+ * drain what is left and then fail with EPIPE.
+ *
+ *     Channel<uint32_t, 16> results("results");
+ *     // producer
+ *     results.Send(value);
+ *     results.Close();
+ *     // consumer
+ *     uint32_t value;
+ *     while (results.Receive(&value) == 0) use(value);
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <lib/errno.h>
+#include <lib/RingBuffer.hpp>
+#include <lib/spinlock.hpp>
+#include <sys/tasks.hpp>
+#include <sys/waitable.hpp>
+
+// every channel's buffer lock counts its contention here
+inline spinlock_class_t channel_locks = SPINLOCK_CLASS_INIT("channel");
+
+template <typename T, size_t N>
+class Channel {
+    // the state word holds the number of buffered values and this flag
+    static constexpr uint32_t CLOSED = 1U << 31;
+    static_assert(N > 0 && N < CLOSED, "channel capacity out of range");
+
+public:
+    /**
+     * @brief Creates an empty, open channel.
+     *
+     * @param name Name of the channel (for debugging tasks)
+     */
+    explicit Channel(const char* name = nullptr)
+        : lock(&channel_locks), state(0)
+    {
+        tasks_sync_init(&receivers);
+        receivers.dbg_name = name;
+        tasks_sync_init(&senders);
+        senders.dbg_name = name;
+        waitable_init(&readable, Readable, this);
+        waitable_init(&writable, Writable, this);
+    }
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    /**
+     * @brief Sends a value, sleeping while the channel is full.
+     *
+     * @param value Value to send
+     * @return int Returns 0 on success and -1 with errno set to EPIPE if
+     * the channel is closed.
+     */
+    int Send(const T& value)
+    {
+        return SendSome(&value, 1, TASKS_NO_TIMEOUT, true) == 1 ? 0 : -1;
+    }
+    /**
+     * @brief Sends a value if there is room for it. Safe to call from
+     * any context.
+     *
+     * @param value Value to send
+     * @return int Returns 0 on success and -1 with errno set to EAGAIN if
+     * the channel is full, or to EPIPE if it is closed.
+     */
+    int TrySend(const T& value)
+    {
+        return SendSome(&value, 1, TASKS_NO_TIMEOUT, false) == 1 ? 0 : -1;
+    }
+    /**
+     * @brief Sends a value, sleeping at most the given time while the
+     * channel is full.
+     *
+     * @param value Value to send
+     * @param timeout_ns Nanoseconds to wait for room at most
+     * @return int Returns 0 on success and -1 with errno set to ETIMEDOUT
+     * if the channel stayed full, or to EPIPE if it is closed.
+     */
+    int TimedSend(const T& value, uint64_t timeout_ns)
+    {
+        return SendSome(&value, 1, tasks_get_time() + timeout_ns, true) == 1 ? 0 : -1;
+    }
+    /**
+     * @brief Sends several values in order, sleeping whenever the channel
+     * is full until all of them are sent. Takes the buffer lock and wakes
+     * receivers once per run of values that fit rather than per value.
+     *
+     * @param values Values to send
+     * @param count Number of values
+     * @return int Number of values sent, which is less than count only if
+     * the channel was closed meanwhile. Returns -1 with errno set to EPIPE
+     * if none were sent.
+     */
+    int SendBatch(const T* values, size_t count)
+    {
+        return SendSome(values, count, TASKS_NO_TIMEOUT, true);
+    }
+
+    /**
+     * @brief Receives a value, sleeping while the channel is empty.
+     *
+     * @param value Where to store the value
+     * @return int Returns 0 on success and -1 with errno set to EPIPE if
+     * the channel is closed and empty.
+     */
+    int Receive(T* value)
+    {
+        return ReceiveSome(value, 1, TASKS_NO_TIMEOUT, true) == 1 ? 0 : -1;
+    }
+    /**
+     * @brief Receives a value if there is one. Safe to call from any
+     * context.
+     *
+     * @param value Where to store the value
+     * @return int Returns 0 on success and -1 with errno set to EAGAIN if
+     * the channel is empty, or to EPIPE if it is also closed.
+     */
+    int TryReceive(T* value)
+    {
+        return ReceiveSome(value, 1, TASKS_NO_TIMEOUT, false) == 1 ? 0 : -1;
+    }
+    /**
+     * @brief Receives a value, sleeping at most the given time while the
+     * channel is empty.
+     *
+     * @param value Where to store the value
+     * @param timeout_ns Nanoseconds to wait for a value at most
+     * @return int Returns 0 on success and -1 with errno set to ETIMEDOUT
+     * if the channel stayed empty, or to EPIPE if it is closed and empty.
+     */
+    int TimedReceive(T* value, uint64_t timeout_ns)
+    {
+        return ReceiveSome(value, 1, tasks_get_time() + timeout_ns, true) == 1 ? 0 : -1;
+    }
+    /**
+     * @brief Receives whatever is buffered, up to max values, sleeping
+     * only while the channel is empty.
+     *
+     * @param values Where to store the values
+     * @param max Most values to receive
+     * @return int Number of values received (at least 1), or -1 with errno
+     * set to EPIPE if the channel is closed and empty.
+     */
+    int ReceiveBatch(T* values, size_t max)
+    {
+        return ReceiveSome(values, max, TASKS_NO_TIMEOUT, true);
+    }
+
+    /**
+     * @brief Closes the channel. Sends fail from now on, while receivers
+     * still get the values already buffered. Wakes every waiting task.
+     *
+     */
+    void Close()
+    {
+        uint32_t flags = lock.LockIrqSave();
+        state |= CLOSED;
+        lock.UnlockIrqRestore(flags);
+        tasks_sync_wake(&receivers, SIZE_MAX);
+        tasks_sync_wake(&senders, SIZE_MAX);
+        waitable_notify(&readable);
+        waitable_notify(&writable);
+    }
+    /**
+     * @brief Gets the number of values buffered.
+     *
+     * @return size_t Number of values waiting to be received
+     */
+    size_t Length() const
+    {
+        return __atomic_load_n(&state, __ATOMIC_RELAXED) & ~CLOSED;
+    }
+    /**
+     * @brief Gets a waitable for use with wait_any() and async_wait(). It
+     * is ready while a value can be received or the channel is closed,
+     * after which TryReceive() should be used.
+     *
+     * @return waitable_t* Waitable for receiving
+     */
+    waitable_t* ReadWaitable() { return &readable; }
+    /**
+     * @brief Gets a waitable that is ready while there is room to send or
+     * the channel is closed, after which TrySend() should be used.
+     *
+     * @return waitable_t* Waitable for sending
+     */
+    waitable_t* WriteWaitable() { return &writable; }
+
+private:
+    // sends or fails without ever sleeping if block is false
+    int SendSome(const T* values, size_t count, uint64_t deadline, bool block)
+    {
+        size_t sent = 0;
+        while (sent < count) {
+            uint32_t flags = lock.LockIrqSave();
+            uint32_t seen = state;
+            size_t batch = 0;
+            if (!(seen & CLOSED)) {
+                while (sent + batch < count && !buffer.IsFull()) {
+                    buffer.Enqueue(values[sent + batch]);
+                    batch++;
+                }
+                state = seen + batch;
+            }
+            lock.UnlockIrqRestore(flags);
+            if (batch != 0) {
+                sent += batch;
+                tasks_sync_wake(&receivers, batch);
+                waitable_notify(&readable);
+                continue;
+            }
+            if (seen & CLOSED) {
+                errno = EPIPE;
+                break;
+            }
+            if (!block) {
+                errno = EAGAIN;
+                break;
+            }
+            // sleeps only if nothing was received or closed since
+            if (tasks_sync_wait_until(&senders, &state, seen, deadline) == -1 && errno == ETIMEDOUT) {
+                break;
+            }
+        }
+        return sent != 0 ? (int)sent : -1;
+    }
+
+    int ReceiveSome(T* values, size_t max, uint64_t deadline, bool block)
+    {
+        for (;;) {
+            uint32_t flags = lock.LockIrqSave();
+            uint32_t seen = state;
+            size_t batch = 0;
+            while (batch < max && buffer.Dequeue(&values[batch]) == 0) {
+                batch++;
+            }
+            state = seen - batch;
+            lock.UnlockIrqRestore(flags);
+            if (batch != 0) {
+                tasks_sync_wake(&senders, batch);
+                waitable_notify(&writable);
+                return (int)batch;
+            }
+            if (seen & CLOSED) {
+                errno = EPIPE;
+                return -1;
+            }
+            if (!block) {
+                errno = EAGAIN;
+                return -1;
+            }
+            if (tasks_sync_wait_until(&receivers, &state, seen, deadline) == -1 && errno == ETIMEDOUT) {
+                return -1;
+            }
+        }
+    }
+
+    static bool Readable(void* owner)
+    {
+        Channel* channel = (Channel*)owner;
+        return __atomic_load_n(&channel->state, __ATOMIC_ACQUIRE) != 0;
+    }
+    static bool Writable(void* owner)
+    {
+        Channel* channel = (Channel*)owner;
+        uint32_t seen = __atomic_load_n(&channel->state, __ATOMIC_ACQUIRE);
+        return (seen & CLOSED) || seen < N;
+    }
+
+    TicketLock lock;            // protects buffer and state
+    RingBuffer<T, N> buffer;
+    uint32_t state;             // buffered values | CLOSED
+    tasks_sync_t receivers;     // tasks waiting for a value
+    tasks_sync_t senders;       // tasks waiting for room
+    waitable_t readable;
+    waitable_t writable;
+};
@@ -0,0 +1,67 @@
+/**
+ * @file condvar.cpp
+ * @author Panix Contributors
+ * @brief Condition variables for use with Mutex
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <lib/condvar.hpp>
+#include <lib/errno.h>
+#include <stddef.h>
+
+CondVar::CondVar(const char* name)
+    : seq(0)
+{
+    tasks_sync_init(&task_sync);
+    task_sync.dbg_name = name;
+}
+
+CondVar::~CondVar()
+{
+    // Nothing to destruct
+}
+
+int CondVar::Wait(Mutex& mutex)
+{
+    return WaitUntil(mutex, TASKS_NO_TIMEOUT);
+}
+
+int CondVar::TimedWait(Mutex& mutex, uint64_t timeout_ns)
+{
+    return WaitUntil(mutex, tasks_get_time() + timeout_ns);
+}
+
+int CondVar::WaitUntil(Mutex& mutex, uint64_t deadline)
+{
+    if (mutex.Owner() != this_cpu_read(current_task)) {
+        errno = EPERM;
+        return -1;
+    }
+    uint32_t snapshot = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+    mutex.Unlock();
+    int status = tasks_sync_wait_until(&task_sync, &seq, snapshot, deadline);
+    bool timed_out = status == -1 && errno == ETIMEDOUT;
+    mutex.Lock();
+    if (timed_out) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}
+
+int CondVar::Signal()
+{
+    __atomic_add_fetch(&seq, 1, __ATOMIC_RELEASE);
+    tasks_sync_wake_one(&task_sync);
+    return 0;
+}
+
+int CondVar::Broadcast()
+{
+    __atomic_add_fetch(&seq, 1, __ATOMIC_RELEASE);
+    tasks_sync_wake(&task_sync, SIZE_MAX);
+    return 0;
+}
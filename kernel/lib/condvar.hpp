@@ -0,0 +1,64 @@
+/**
+ * @file condvar.hpp
+ * @author Panix Contributors
+ * @brief Condition variables for use with Mutex
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <sys/tasks.hpp>
+#include <lib/mutex.hpp>
+
+class CondVar {
+public:
+    CondVar(const char* name = nullptr);
+    ~CondVar();
+    /**
+     * @brief Unlocks the mutex and sleeps until the condition variable
+     * is signalled, then locks the mutex again. No signal sent after the
+     * mutex was unlocked can be missed. Wake ups can be spurious, so the
+     * condition has to be checked again in a loop.
+     *
+     * @param mutex Mutex protecting the condition, held by the caller
+     * @return int Returns 0 on success and -1 with errno set to EPERM
+     * if the caller doesn't hold the mutex.
+     */
+    int Wait(Mutex& mutex);
+    /**
+     * @brief Same as Wait(), except that the task stops waiting after
+     * the given time. The mutex is locked again either way.
+     *
+     * @param mutex Mutex protecting the condition, held by the caller
+     * @param timeout_ns Nanoseconds to wait for at most
+     * @return int Returns 0 on success and -1 with errno set to
+     * ETIMEDOUT if it wasn't signalled in time, or EPERM if the caller
+     * doesn't hold the mutex.
+     */
+    int TimedWait(Mutex& mutex, uint64_t timeout_ns);
+    /**
+     * @brief Wakes the most urgent task waiting on the condition variable,
+     * or the one that has waited longest among equally urgent ones.
+     *
+     * @return int Returns 0 on success and -1 on error.
+     */
+    int Signal();
+    /**
+     * @brief Wakes every task waiting on the condition variable.
+     *
+     * @return int Returns 0 on success and -1 on error.
+     */
+    int Broadcast();
+
+private:
+    // Bumped by every signal. Waiters sleep for as long as it still
+    // has the value they saw before unlocking the mutex, so a signal
+    // sent in between stops them from going to sleep at all.
+    uint32_t seq;
+    tasks_sync_t task_sync;
+    int WaitUntil(Mutex& mutex, uint64_t deadline);
+};
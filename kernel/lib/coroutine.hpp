@@ -0,0 +1,123 @@
+/**
+ * @file coroutine.hpp
+ * @author Panix Contributors
+ * @brief The parts of the C++20 <coroutine> header that the compiler
+ * needs to build coroutines. There is no standard library in the kernel,
+ * but GCC looks these names up in namespace std, so they have to live
+ * there. They are thin wrappers around the GCC coroutine builtins.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+
+namespace std {
+
+template <typename Result, typename... Args>
+struct coroutine_traits {
+    using promise_type = typename Result::promise_type;
+};
+
+template <typename Promise = void>
+struct coroutine_handle;
+
+template <>
+struct coroutine_handle<void> {
+    constexpr coroutine_handle() noexcept : frame(nullptr) { }
+    constexpr coroutine_handle(decltype(nullptr)) noexcept : frame(nullptr) { }
+
+    constexpr void* address() const noexcept { return frame; }
+    static constexpr coroutine_handle from_address(void* addr) noexcept
+    {
+        coroutine_handle handle;
+        handle.frame = addr;
+        return handle;
+    }
+
+    constexpr explicit operator bool() const noexcept { return frame != nullptr; }
+    bool done() const noexcept { return __builtin_coro_done(frame); }
+    void operator()() const { resume(); }
+    void resume() const { __builtin_coro_resume(frame); }
+    void destroy() const { __builtin_coro_destroy(frame); }
+
+protected:
+    void* frame;
+};
+
+template <typename Promise>
+struct coroutine_handle : coroutine_handle<void> {
+    constexpr coroutine_handle() noexcept { }
+    constexpr coroutine_handle(decltype(nullptr)) noexcept { }
+
+    static coroutine_handle from_promise(Promise& promise) noexcept
+    {
+        coroutine_handle handle;
+        handle.frame = __builtin_coro_promise((char*)&promise, __alignof(Promise), true);
+        return handle;
+    }
+    static constexpr coroutine_handle from_address(void* addr) noexcept
+    {
+        coroutine_handle handle;
+        handle.frame = addr;
+        return handle;
+    }
+
+    Promise& promise() const
+    {
+        return *(Promise*)__builtin_coro_promise(frame, __alignof(Promise), false);
+    }
+};
+
+// A coroutine that does nothing when resumed. Returned from
+// await_suspend() when there is nothing to transfer control to.
+struct noop_coroutine_promise { };
+
+template <>
+struct coroutine_handle<noop_coroutine_promise> : coroutine_handle<void> {
+    constexpr bool done() const noexcept { return false; }
+    void operator()() const noexcept { }
+    void resume() const noexcept { }
+    void destroy() const noexcept { }
+
+private:
+    friend coroutine_handle noop_coroutine() noexcept;
+
+    // laid out like a GCC coroutine frame: resume and destroy
+    // function pointers, then the promise
+    struct noop_frame {
+        static void nothing() { }
+        void (*resume)() = nothing;
+        void (*destroy)() = nothing;
+        noop_coroutine_promise promise;
+    };
+    static noop_frame noop;
+
+    coroutine_handle() noexcept { frame = &noop; }
+};
+
+using noop_coroutine_handle = coroutine_handle<noop_coroutine_promise>;
+
+inline noop_coroutine_handle::noop_frame noop_coroutine_handle::noop { };
+
+inline noop_coroutine_handle noop_coroutine() noexcept
+{
+    return noop_coroutine_handle();
+}
+
+struct suspend_always {
+    constexpr bool await_ready() const noexcept { return false; }
+    constexpr void await_suspend(coroutine_handle<>) const noexcept { }
+    constexpr void await_resume() const noexcept { }
+};
+
+struct suspend_never {
+    constexpr bool await_ready() const noexcept { return true; }
+    constexpr void await_suspend(coroutine_handle<>) const noexcept { }
+    constexpr void await_resume() const noexcept { }
+};
+
+}
@@ -20,14 +20,16 @@
 
 #include <lib/mutex.hpp>
 #include <lib/errno.h>
+#include <arch/arch.hpp>
 #include <mem/heap.hpp>
 #include <stddef.h>
 
-Mutex::Mutex(const char* name)
-    : locked(false)
+Mutex::Mutex(const char* name, bool inherit)
+    : locked(UNLOCKED)
 {
-    task_sync.dbg_name = name;
     tasks_sync_init(&task_sync);
+    task_sync.dbg_name = name;
+    task_sync.inherit = inherit;
 };
 
 Mutex::~Mutex()
@@ -37,31 +39,99 @@ Mutex::~Mutex()
 
 int Mutex::Lock()
 {
-    // Check if the Mutex is unlocked
-    while (__atomic_test_and_set(&locked, __ATOMIC_RELEASE)) {
-        // Block the current kernel task
-        TASK_ONLY tasks_sync_block(&task_sync);
+    // Fast path: take a free mutex with a single atomic operation
+    uint32_t expected = UNLOCKED;
+    if (!__atomic_compare_exchange_n(&locked, &expected, LOCKED, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return LockSlow(TASKS_NO_TIMEOUT);
     }
+    task_sync.possessor = this_cpu_read(current_task);
     // Success, return 0
     return 0;
 }
 
+int Mutex::TimedLock(uint64_t timeout_ns)
+{
+    uint32_t expected = UNLOCKED;
+    if (!__atomic_compare_exchange_n(&locked, &expected, LOCKED, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return LockSlow(tasks_get_time() + timeout_ns);
+    }
+    task_sync.possessor = this_cpu_read(current_task);
+    return 0;
+}
+
+int Mutex::LockSlow(uint64_t deadline)
+{
+    // Mark the mutex as contended so that the holder's Unlock() takes the
+    // slow path. If it was freed in the meantime then we now hold it (still
+    // marked contended, which only costs the next Unlock() a wait list check).
+    while (__atomic_exchange_n(&locked, CONTENDED, __ATOMIC_ACQUIRE) != UNLOCKED) {
+        // Wait in line while it is still held. If the owner hands the
+        // mutex over to us on unlock then we already hold it.
+        int status = tasks_sync_wait_until(&task_sync, &locked, CONTENDED, deadline);
+        if (status == 1) {
+            // UnlockSlow() already made us the possessor
+            return 0;
+        }
+        if (status == -1 && errno == ETIMEDOUT) {
+            // The mutex stays marked contended, which at worst
+            // sends the next Unlock() down the slow path
+            return -1;
+        }
+    }
+    task_sync.possessor = this_cpu_read(current_task);
+    return 0;
+}
+
 int Mutex::Trylock()
 {
     // If we cannot immediately acquire the lock then just return an error
-    if (__atomic_test_and_set(&locked, __ATOMIC_RELEASE)) {
+    uint32_t expected = UNLOCKED;
+    if (!__atomic_compare_exchange_n(&locked, &expected, LOCKED, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
         errno = EINVAL;
         return -1;
     }
+    task_sync.possessor = this_cpu_read(current_task);
     // Success, return 0
     return 0;
 }
 
 int Mutex::Unlock()
 {
-    // Clear the lock
-    __atomic_clear(&locked, __ATOMIC_RELEASE);
-    TASK_ONLY tasks_sync_unblock(&task_sync);
+    // Fast path: nobody is waiting, so just release it
+    uint32_t expected = LOCKED;
+    if (__atomic_compare_exchange_n(&locked, &expected, UNLOCKED, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        // Only clear the holder if nobody has taken the mutex since
+        task_t *self = this_cpu_read(current_task);
+        __atomic_compare_exchange_n(&task_sync.possessor, &self, (task_t *)NULL, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    } else {
+        // Waiters keep seeing us as the holder (and keep boosting us)
+        // until the handoff passes the mutex on under the scheduler lock
+        UnlockSlow();
+    }
     // Success, return 0
     return 0;
 }
+
+void Mutex::UnlockSlow()
+{
+    // Waiters only queue up while the mutex is marked contended and
+    // interrupts are enabled, so with them disabled the queue can't
+    // change under us
+    uint32_t flags = interrupts_save();
+    // Pass the lock (and the possessor) straight to the most urgent waiting
+    // task if there is one, otherwise clear both
+    task_t *next = tasks_sync_handoff(&task_sync);
+    if (next == NULL) {
+        __atomic_store_n(&locked, UNLOCKED, __ATOMIC_RELEASE);
+    } else {
+        // Unlock() can take the fast path again once the queue is empty
+        __atomic_store_n(&locked, task_sync.waiting.head != NULL ? CONTENDED : LOCKED,
+                         __ATOMIC_RELAXED);
+    }
+    interrupts_restore(flags);
+}
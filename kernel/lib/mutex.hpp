@@ -15,7 +15,14 @@
 
 class Mutex {
 public:
-    Mutex(const char* name = nullptr);
+    /**
+     * @brief Creates an unlocked mutex.
+     *
+     * @param name Name of the mutex (for debugging tasks)
+     * @param inherit Boost the holder to the priority of its most
+     * urgent waiter while it holds the mutex
+     */
+    Mutex(const char* name = nullptr, bool inherit = true);
     /**
      * @brief Destroys a mutex and removes it from memory.
      *
@@ -30,6 +37,15 @@ public:
      * @return int Returns 0 on success and -1 on error.
      */
     int Lock();
+    /**
+     * @brief Locks a mutex, but gives up if it can't be taken
+     * within the given time.
+     *
+     * @param timeout_ns Nanoseconds to wait for at most
+     * @return int Returns 0 on success and -1 with errno set to
+     * ETIMEDOUT if the mutex is still held after the timeout.
+     */
+    int TimedLock(uint64_t timeout_ns);
     /**
      * @brief Attempts to lock a mutex. If the mutex is
      * currently locked then the function will return and
@@ -44,8 +60,28 @@ public:
      * @return int Returns 0 on success and -1 on error.
      */
     int Unlock();
+    /**
+     * @brief Gets the task currently holding the mutex (for
+     * diagnostics only, the answer may be stale immediately).
+     *
+     * @return task_t* Holding task, or NULL if the mutex is free
+     * or was locked before tasking started.
+     */
+    task_t *Owner() const { return task_sync.possessor; }
 
 private:
-    bool locked;
+    enum state : uint32_t {
+        UNLOCKED = 0,
+        LOCKED,         // held, nobody waiting
+        CONTENDED,      // held, and tasks may be waiting
+    };
+    // Uncontended Lock() and Unlock() are a single compare and
+    // exchange of this word. The scheduler is only involved once
+    // it has been marked as contended.
+    // The holder is recorded as the possessor of task_sync so that
+    // waiters know whose priority to boost.
+    uint32_t locked;
     tasks_sync_t task_sync;
+    int LockSlow(uint64_t deadline);
+    void UnlockSlow();
 };
@@ -0,0 +1,151 @@
+/**
+ * @file rwlock.cpp
+ * @author Panix Contributors
+ * @brief Reader-writer lock with writer preference
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <lib/rwlock.hpp>
+#include <lib/errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+RWLock::RWLock(const char* name)
+    : state(0)
+{
+    tasks_sync_init(&readers);
+    tasks_sync_init(&writers);
+    readers.dbg_name = name;
+    writers.dbg_name = name;
+}
+
+RWLock::~RWLock()
+{
+    // Nothing to destruct
+}
+
+int RWLock::ReadLock()
+{
+    return ReadLockUntil(TASKS_NO_TIMEOUT);
+}
+
+int RWLock::TimedReadLock(uint64_t timeout_ns)
+{
+    return ReadLockUntil(tasks_get_time() + timeout_ns);
+}
+
+int RWLock::ReadLockUntil(uint64_t deadline)
+{
+    uint32_t cur = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    for (;;) {
+        // Writers take precedence, so stay out while one is holding
+        // the lock or waiting for it
+        if ((cur & (WRITER_HELD | WRITER_MASK)) == 0) {
+            if (__atomic_compare_exchange_n(&state, &cur, cur + 1, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return 0;
+            }
+            continue;
+        }
+        // Sleep until the state changes (returns right away if it already has)
+        if (tasks_sync_wait_until(&readers, &state, cur, deadline) == -1 && errno == ETIMEDOUT) {
+            return -1;
+        }
+        cur = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    }
+}
+
+int RWLock::TryReadLock()
+{
+    uint32_t cur = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    do {
+        if (cur & (WRITER_HELD | WRITER_MASK)) {
+            errno = EBUSY;
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&state, &cur, cur + 1, false,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    return 0;
+}
+
+int RWLock::ReadUnlock()
+{
+    uint32_t cur = __atomic_sub_fetch(&state, 1, __ATOMIC_RELEASE);
+    // The last reader out lets a waiting writer in
+    if ((cur & READER_MASK) == 0 && (cur & WRITER_MASK) != 0) {
+        tasks_sync_wake_one(&writers);
+    }
+    return 0;
+}
+
+int RWLock::WriteLock()
+{
+    return WriteLockUntil(TASKS_NO_TIMEOUT);
+}
+
+int RWLock::TimedWriteLock(uint64_t timeout_ns)
+{
+    return WriteLockUntil(tasks_get_time() + timeout_ns);
+}
+
+int RWLock::WriteLockUntil(uint64_t deadline)
+{
+    uint32_t cur = 0;
+    // Fast path: nobody is using the lock
+    if (__atomic_compare_exchange_n(&state, &cur, WRITER_HELD, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    // Announce ourselves so that no new readers get in
+    cur = __atomic_add_fetch(&state, WRITER_ONE, __ATOMIC_RELAXED);
+    for (;;) {
+        if ((cur & (WRITER_HELD | READER_MASK)) == 0) {
+            if (__atomic_compare_exchange_n(&state, &cur, (cur - WRITER_ONE) | WRITER_HELD, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return 0;
+            }
+            continue;
+        }
+        if (tasks_sync_wait_until(&writers, &state, cur, deadline) == -1 && errno == ETIMEDOUT) {
+            // Withdraw, and pass on any wake up that was meant for us
+            cur = __atomic_sub_fetch(&state, WRITER_ONE, __ATOMIC_RELAXED);
+            if ((cur & (WRITER_HELD | READER_MASK)) == 0 && (cur & WRITER_MASK) != 0) {
+                tasks_sync_wake_one(&writers);
+            } else if ((cur & (WRITER_HELD | WRITER_MASK)) == 0 && readers.waiting.head != NULL) {
+                // Readers were only held back by us
+                tasks_sync_wake(&readers, SIZE_MAX);
+            }
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        cur = __atomic_load_n(&state, __ATOMIC_RELAXED);
+    }
+}
+
+int RWLock::TryWriteLock()
+{
+    uint32_t cur = 0;
+    if (!__atomic_compare_exchange_n(&state, &cur, WRITER_HELD, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        errno = EBUSY;
+        return -1;
+    }
+    return 0;
+}
+
+int RWLock::WriteUnlock()
+{
+    uint32_t cur = __atomic_and_fetch(&state, ~WRITER_HELD, __ATOMIC_RELEASE);
+    if (cur & WRITER_MASK) {
+        // Writers take precedence
+        tasks_sync_wake_one(&writers);
+    } else if (readers.waiting.head != NULL) {
+        // Any reader that queues up after this point sees the
+        // state change and won't block, so nobody gets left behind
+        tasks_sync_wake(&readers, SIZE_MAX);
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file rwlock.hpp
+ * @author Panix Contributors
+ * @brief Reader-writer lock with writer preference
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <sys/tasks.hpp>
+
+class RWLock {
+public:
+    RWLock(const char* name = nullptr);
+    ~RWLock();
+    /**
+     * @brief Takes the lock for reading. Any number of readers may hold
+     * it at once, but new readers wait while a writer holds or is
+     * waiting for the lock.
+     *
+     * @return int Returns 0 on success and -1 on error.
+     */
+    int ReadLock();
+    /**
+     * @brief Takes the lock for reading, but gives up if it can't
+     * be taken within the given time.
+     *
+     * @param timeout_ns Nanoseconds to wait for at most
+     * @return int Returns 0 on success and -1 with errno set to
+     * ETIMEDOUT if the lock is still unavailable after the timeout.
+     */
+    int TimedReadLock(uint64_t timeout_ns);
+    /**
+     * @brief Attempts to take the lock for reading without blocking.
+     *
+     * @return int Returns 0 on success and -1 with errno set to
+     * EBUSY if the lock is not available.
+     */
+    int TryReadLock();
+    /**
+     * @brief Releases a read lock.
+     *
+     * @return int Returns 0 on success and -1 on error.
+     */
+    int ReadUnlock();
+    /**
+     * @brief Takes the lock for writing, waiting for all readers
+     * and any other writer to leave first.
+     *
+     * @return int Returns 0 on success and -1 on error.
+     */
+    int WriteLock();
+    /**
+     * @brief Takes the lock for writing, but gives up if it can't
+     * be taken within the given time.
+     *
+     * @param timeout_ns Nanoseconds to wait for at most
+     * @return int Returns 0 on success and -1 with errno set to
+     * ETIMEDOUT if the lock is still unavailable after the timeout.
+     */
+    int TimedWriteLock(uint64_t timeout_ns);
+    /**
+     * @brief Attempts to take the lock for writing without blocking.
+     *
+     * @return int Returns 0 on success and -1 with errno set to
+     * EBUSY if the lock is not available.
+     */
+    int TryWriteLock();
+    /**
+     * @brief Releases a write lock. Waiting writers go first,
+     * otherwise all waiting readers are let in together.
+     *
+     * @return int Returns 0 on success and -1 on error.
+     */
+    int WriteUnlock();
+
+private:
+    // Lock state word. Readers and writers both block on changes to it.
+    static constexpr uint32_t READER_MASK = 0x0000FFFF;  // readers holding the lock
+    static constexpr uint32_t WRITER_ONE  = 0x00010000;  // one waiting writer
+    static constexpr uint32_t WRITER_MASK = 0x7FFF0000;  // writers waiting
+    static constexpr uint32_t WRITER_HELD = 0x80000000;  // a writer holds the lock
+    uint32_t state;
+    tasks_sync_t readers;
+    tasks_sync_t writers;
+    int ReadLockUntil(uint64_t deadline);
+    int WriteLockUntil(uint64_t deadline);
+};
@@ -20,6 +20,7 @@
 
 #include <lib/errno.h>
 #include <lib/semaphore.hpp>
+#include <arch/arch.hpp>
 #include <mem/heap.hpp>
 #include <stddef.h>
 
@@ -38,8 +39,9 @@ Semaphore::Semaphore(uint32_t val, bool share, const char* name)
     : shared(share)
     , count(val)
 {
-    task_sync.dbg_name = name;
     tasks_sync_init(&task_sync);
+    task_sync.dbg_name = name;
+    waitable_init(&waitable, Ready, this);
 }
 
 Semaphore::~Semaphore()
@@ -55,7 +57,11 @@ int Semaphore::Wait()
     // If the semaphore counter is already 0 then just skip the compare and exhange.
     do {
         while (curVal == 0) {
-            TASK_ONLY tasks_sync_block(&task_sync);
+            // Wait in line while the count is 0. If a post hands its
+            // permit straight to us then we are done.
+            if (tasks_sync_wait(&task_sync, &count, 0) == 1) {
+                return 0;
+            }
             curVal = count;
         }
         // Fail using atomic relaxed because it may allow us to get to the "waiting" state faster.
@@ -85,14 +91,25 @@ int Semaphore::TryWait()
 
 int Semaphore::TimedWait(const uint32_t* usec)
 {
-    // TODO: Add the timer functionality here.
-    (void)usec;
+    if (usec == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t deadline = tasks_get_time() + *usec * 1000ULL;
     // Used to store the current value of the semaphore for atomic comparison later.
     uint32_t curVal = count;
     // Compare the semaphore's current value to the value recorded earlier.
     // If the semaphore counter is already 0 then just skip the compare and exhange.
     do {
         while (curVal == 0) {
+            // Same as Wait(), except that we stop waiting at the deadline
+            int status = tasks_sync_wait_until(&task_sync, &count, 0, deadline);
+            if (status == 1) {
+                return 0;
+            }
+            if (status == -1 && errno == ETIMEDOUT) {
+                return -1;
+            }
             curVal = count;
         }
         // Fail using atomic relaxed because it may allow us to get to the "waiting" state faster.
@@ -103,8 +120,16 @@ int Semaphore::TimedWait(const uint32_t* usec)
 
 int Semaphore::Post()
 {
-    __atomic_fetch_add(&count, 1, __ATOMIC_RELEASE);
-    TASK_ONLY tasks_sync_unblock(&task_sync);
+    // Waiters only queue up while the count is 0 and interrupts are
+    // enabled, so with them disabled the queue can't change under us
+    uint32_t flags = interrupts_save();
+    // Give the permit directly to the most urgent waiting task if there is
+    // one, otherwise make it available to the next Wait()
+    if (tasks_sync_handoff(&task_sync) == NULL) {
+        __atomic_fetch_add(&count, 1, __ATOMIC_RELEASE);
+        waitable_notify(&waitable);
+    }
+    interrupts_restore(flags);
     return 0;
 }
 
@@ -113,3 +138,14 @@ int Semaphore::Count(uint32_t* val)
     __atomic_load(&count, val, __ATOMIC_ACQUIRE);
     return 0;
 }
+
+waitable_t* Semaphore::Waitable()
+{
+    return &waitable;
+}
+
+bool Semaphore::Ready(void* owner)
+{
+    Semaphore* sem = (Semaphore*)owner;
+    return __atomic_load_n(&sem->count, __ATOMIC_ACQUIRE) != 0;
+}
@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <sys/tasks.hpp>
+#include <sys/waitable.hpp>
 
 class Semaphore {
 public:
@@ -58,12 +59,13 @@ public:
      * timeout does not mean that within the given period of time the
      * semaphore will be unlocked but rather that after the timeout period
      * the thread or process will unblock and may resume execution without
-     * access to the semaphore's reference variable.
+     * access to the semaphore's reference variable. The task sleeps on
+     * the semaphore in the meantime.
      *
      * @param usec Microseconds to wait until resuming execution without
      * access to the semaphore's intended reference variable.
-     * @return int Returns 0 on success and -1 on failure.
-     * When an error occurs errno is set.
+     * @return int Returns 0 on success and -1 on failure. errno is set
+     * to ETIMEDOUT if the timeout passed, or EINVAL if usec is NULL.
      */
     int TimedWait(const uint32_t* usec);
     /**
@@ -83,9 +85,20 @@ public:
      * When an error occurs errno is set.
      */
     int Count(uint32_t* val);
+    /**
+     * @brief Gets the semaphore's waitable for use with wait_any(). It is
+     * ready while the count is above 0, after which TryWait() should be
+     * used to take the semaphore.
+     *
+     * @return waitable_t* The semaphore's waitable
+     */
+    waitable_t* Waitable();
 
 private:
+    static bool Ready(void* owner);
+
     bool shared;
     uint32_t count;
     tasks_sync_t task_sync;
+    waitable_t waitable;
 };
@@ -0,0 +1,70 @@
+/**
+ * @file seqlock.hpp
+ * @author Panix Contributors
+ * @brief Sequence lock for small, read-mostly data. Readers never block
+ * and never write to the lock; they simply retry if a writer got in the
+ * way. Writers must be serialized by the caller, and a writer that can be
+ * interrupted by a reader on the same CPU must disable interrupts.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+class Seqlock {
+public:
+    Seqlock() : sequence(0) { }
+    /**
+     * @brief Starts a read section. Waits for any write
+     * in progress to finish first.
+     *
+     * @return uint32_t Sequence number to pass to ReadRetry()
+     */
+    uint32_t ReadBegin() const
+    {
+        uint32_t start;
+        // an odd sequence number means a write is in progress
+        while ((start = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE)) & 1) {
+            asm volatile("pause");
+        }
+        return start;
+    }
+    /**
+     * @brief Ends a read section.
+     *
+     * @param start Value returned by the matching ReadBegin()
+     * @return true The data was written meanwhile, so read it again
+     * @return false The data read is consistent
+     */
+    bool ReadRetry(uint32_t start) const
+    {
+        // keep the protected reads from being moved after the check
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&sequence, __ATOMIC_RELAXED) != start;
+    }
+    /**
+     * @brief Starts a write section.
+     *
+     */
+    void WriteBegin()
+    {
+        __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELAXED);
+        // keep the protected writes from being moved before the increment
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+    /**
+     * @brief Ends a write section.
+     *
+     */
+    void WriteEnd()
+    {
+        __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    uint32_t sequence;
+};
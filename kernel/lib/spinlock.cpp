@@ -0,0 +1,24 @@
+/**
+ * @file spinlock.cpp
+ * @author Panix Contributors
+ * @brief Spinlock contention statistics
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <lib/spinlock.hpp>
+#include <dev/serial/rs232.hpp>
+
+void spinlock_dump()
+{
+    // classes are only ever added to the front of the list
+    for (spinlock_class_t *lock_class = __atomic_load_n(&spinlock_classes, __ATOMIC_ACQUIRE);
+         lock_class != nullptr; lock_class = lock_class->next) {
+        rs232::printf("spinlock %s %u %u %u\n", lock_class->name,
+            __atomic_load_n(&lock_class->contended, __ATOMIC_RELAXED),
+            __atomic_load_n(&lock_class->spins, __ATOMIC_RELAXED),
+            __atomic_load_n(&lock_class->max_spins, __ATOMIC_RELAXED));
+    }
+}
@@ -0,0 +1,325 @@
+/**
+ * @file spinlock.hpp
+ * @author Panix Contributors
+ * @brief Spinlocks for short critical sections that must not sleep, such
+ * as data shared with interrupt handlers or between CPUs. TicketLock
+ * hands the lock out in arrival order using two counters. McsLock queues
+ * waiters on nodes they bring along, so each one spins on its own cache
+ * line, which scales better once many CPUs contend for one lock. Both
+ * disable preemption while held. Use the IrqSave variants if the lock is
+ * also taken from an interrupt handler. Locks may name a spinlock_class_t
+ * that counts how often locks of that class were contended.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef TESTING
+// the unit tests run the locks on the host, without a scheduler
+static inline void preempt_disable() { }
+static inline void preempt_enable() { }
+static inline uint32_t interrupts_save() { return 0; }
+static inline void interrupts_restore(uint32_t flags) { (void)flags; }
+#else
+#include <sys/tasks.hpp>
+#endif
+
+/**
+ * @brief Contention statistics shared by a set of locks. A class is
+ * registered in spinlock_classes the first time one of its locks is
+ * contended.
+ *
+ */
+typedef struct spinlock_class spinlock_class_t;
+struct spinlock_class
+{
+    const char *name;
+    uint32_t contended;         // acquisitions that had to wait
+    uint32_t spins;             // spin loop iterations spent waiting (wraps)
+    uint32_t max_spins;         // longest wait, in spin loop iterations
+    spinlock_class_t *next;     // next registered class
+    uint32_t registered;
+};
+
+#define SPINLOCK_CLASS_INIT(class_name) { \
+    .name = class_name, .contended = 0, .spins = 0, .max_spins = 0, .next = nullptr, .registered = 0 }
+
+// every class that has seen contention
+inline spinlock_class_t *spinlock_classes = nullptr;
+
+namespace spinlock_detail {
+
+static inline void relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    asm volatile("pause" ::: "memory");
+#endif
+}
+
+static inline void contended(spinlock_class_t *lock_class, uint32_t spins)
+{
+    if (lock_class == nullptr) {
+        return;
+    }
+    if (__atomic_exchange_n(&lock_class->registered, 1, __ATOMIC_RELAXED) == 0) {
+        spinlock_class_t *head = __atomic_load_n(&spinlock_classes, __ATOMIC_RELAXED);
+        do {
+            lock_class->next = head;
+        } while (!__atomic_compare_exchange_n(&spinlock_classes, &head, lock_class, true,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    __atomic_add_fetch(&lock_class->contended, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&lock_class->spins, spins, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&lock_class->max_spins, __ATOMIC_RELAXED);
+    while (spins > max && !__atomic_compare_exchange_n(&lock_class->max_spins, &max, spins, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+}
+
+}
+
+/**
+ * @brief A fair spinlock: each locker draws a ticket and waits until
+ * it is served, so the lock is handed out in the order it was asked for.
+ *
+ */
+class TicketLock {
+public:
+    /**
+     * @brief Creates an unlocked spinlock.
+     *
+     * @param lock_class Class to count contention in, or nullptr
+     */
+    explicit TicketLock(spinlock_class_t *lock_class = nullptr)
+        : next(0), owner(0), stats(lock_class) { }
+    TicketLock(const TicketLock&) = delete;
+    TicketLock& operator=(const TicketLock&) = delete;
+
+    /**
+     * @brief Takes the lock, spinning until it is free. Preemption is
+     * disabled until it is unlocked.
+     *
+     */
+    void Lock()
+    {
+        preempt_disable();
+        uint32_t ticket = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&owner, __ATOMIC_ACQUIRE) == ticket) {
+            return;
+        }
+        uint32_t spins = 0;
+        while (__atomic_load_n(&owner, __ATOMIC_ACQUIRE) != ticket) {
+            spinlock_detail::relax();
+            spins++;
+        }
+        spinlock_detail::contended(stats, spins);
+    }
+    /**
+     * @brief Takes the lock if it is free.
+     *
+     * @return true The lock was taken
+     * @return false Someone else holds it
+     */
+    bool TryLock()
+    {
+        preempt_disable();
+        uint32_t served = __atomic_load_n(&owner, __ATOMIC_ACQUIRE);
+        // the lock is free when the next ticket is the one being served
+        if (__atomic_compare_exchange_n(&next, &served, served + 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return true;
+        }
+        preempt_enable();
+        return false;
+    }
+    /**
+     * @brief Releases the lock to the next waiter.
+     *
+     */
+    void Unlock()
+    {
+        __atomic_store_n(&owner, owner + 1, __ATOMIC_RELEASE);
+        preempt_enable();
+    }
+    /**
+     * @brief Disables interrupts and takes the lock.
+     *
+     * @return uint32_t Interrupt state to pass to UnlockIrqRestore()
+     */
+    uint32_t LockIrqSave()
+    {
+        uint32_t flags = interrupts_save();
+        Lock();
+        return flags;
+    }
+    /**
+     * @brief Releases the lock and restores the interrupt state.
+     *
+     * @param flags Value returned by LockIrqSave()
+     */
+    void UnlockIrqRestore(uint32_t flags)
+    {
+        __atomic_store_n(&owner, owner + 1, __ATOMIC_RELEASE);
+        // interrupts first, so that a postponed task switch
+        // doesn't happen with them still disabled
+        interrupts_restore(flags);
+        preempt_enable();
+    }
+    /**
+     * @brief Checks whether the lock is held (for assertions only).
+     *
+     * @return true Someone holds the lock
+     */
+    bool IsLocked() const
+    {
+        return __atomic_load_n(&next, __ATOMIC_RELAXED) != __atomic_load_n(&owner, __ATOMIC_RELAXED);
+    }
+
+private:
+    uint32_t next;      // next ticket to draw
+    uint32_t owner;     // ticket being served
+    spinlock_class_t *stats;
+};
+
+/**
+ * @brief A queue-based (Mellor-Crummey and Scott) spinlock. Each locker
+ * brings a node, typically on its stack, and spins on that node only.
+ * The node must stay valid until the lock is released with it.
+ *
+ */
+class McsLock {
+public:
+    struct Node {
+        Node *next;
+        uint32_t waiting;
+    };
+
+    /**
+     * @brief Creates an unlocked spinlock.
+     *
+     * @param lock_class Class to count contention in, or nullptr
+     */
+    explicit McsLock(spinlock_class_t *lock_class = nullptr)
+        : tail(nullptr), stats(lock_class) { }
+    McsLock(const McsLock&) = delete;
+    McsLock& operator=(const McsLock&) = delete;
+
+    /**
+     * @brief Takes the lock, spinning until it is free. Preemption is
+     * disabled until it is unlocked.
+     *
+     * @param node Queue node for this locker
+     */
+    void Lock(Node &node)
+    {
+        preempt_disable();
+        node.next = nullptr;
+        node.waiting = 1;
+        Node *prev = __atomic_exchange_n(&tail, &node, __ATOMIC_ACQ_REL);
+        if (prev == nullptr) {
+            return;
+        }
+        // queue up behind the previous locker, who hands the lock over
+        __atomic_store_n(&prev->next, &node, __ATOMIC_RELEASE);
+        uint32_t spins = 0;
+        while (__atomic_load_n(&node.waiting, __ATOMIC_ACQUIRE)) {
+            spinlock_detail::relax();
+            spins++;
+        }
+        spinlock_detail::contended(stats, spins);
+    }
+    /**
+     * @brief Takes the lock if it is free.
+     *
+     * @param node Queue node for this locker
+     * @return true The lock was taken
+     * @return false Someone else holds it
+     */
+    bool TryLock(Node &node)
+    {
+        preempt_disable();
+        node.next = nullptr;
+        node.waiting = 0;
+        Node *expected = nullptr;
+        if (__atomic_compare_exchange_n(&tail, &expected, &node, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return true;
+        }
+        preempt_enable();
+        return false;
+    }
+    /**
+     * @brief Releases the lock to the next waiter in the queue.
+     *
+     * @param node Node the lock was taken with
+     */
+    void Unlock(Node &node)
+    {
+        Release(node);
+        preempt_enable();
+    }
+    /**
+     * @brief Disables interrupts and takes the lock.
+     *
+     * @param node Queue node for this locker
+     * @return uint32_t Interrupt state to pass to UnlockIrqRestore()
+     */
+    uint32_t LockIrqSave(Node &node)
+    {
+        uint32_t flags = interrupts_save();
+        Lock(node);
+        return flags;
+    }
+    /**
+     * @brief Releases the lock and restores the interrupt state.
+     *
+     * @param node Node the lock was taken with
+     * @param flags Value returned by LockIrqSave()
+     */
+    void UnlockIrqRestore(Node &node, uint32_t flags)
+    {
+        Release(node);
+        interrupts_restore(flags);
+        preempt_enable();
+    }
+    /**
+     * @brief Checks whether the lock is held (for assertions only).
+     *
+     * @return true Someone holds the lock
+     */
+    bool IsLocked() const { return __atomic_load_n(&tail, __ATOMIC_RELAXED) != nullptr; }
+
+private:
+    void Release(Node &node)
+    {
+        Node *successor = __atomic_load_n(&node.next, __ATOMIC_ACQUIRE);
+        if (successor == nullptr) {
+            // nobody queued, unless one is between swapping the tail
+            // and linking itself in
+            Node *expected = &node;
+            if (__atomic_compare_exchange_n(&tail, &expected, nullptr, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            while ((successor = __atomic_load_n(&node.next, __ATOMIC_ACQUIRE)) == nullptr) {
+                spinlock_detail::relax();
+            }
+        }
+        __atomic_store_n(&successor->waiting, 0, __ATOMIC_RELEASE);
+    }
+
+    Node *tail;         // last locker in the queue, nullptr if free
+    spinlock_class_t *stats;
+};
+
+/**
+ * @brief Prints the contention counters of every class that has seen
+ * contention to serial: "spinlock <name> <contended> <spins> <max spins>".
+ *
+ */
+void spinlock_dump();
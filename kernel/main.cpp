@@ -12,6 +12,13 @@
 #include <stdint.h>
 #include <sys/panic.hpp>
 #include <sys/tasks.hpp>
+#include <sys/workqueue.hpp>
+#include <sys/threadpool.hpp>
+#include <sys/rcu.hpp>
+#include <sys/hrtimer.hpp>
+#include <sys/async.hpp>
+#include <sys/schedstat.hpp>
+#include <sys/top.hpp>
 #include <lib/string.hpp>
 #include <lib/stdio.hpp>
 // Bootloader
@@ -19,6 +26,7 @@
 // Memory management & paging
 #include <mem/heap.hpp>
 #include <mem/paging.hpp>
+#include <mem/wss.hpp>
 // Architecture specific code
 #include <arch/arch.hpp>
 // Generic devices
@@ -33,12 +41,18 @@
 #include <apps/primes.hpp>
 #include <apps/spinner.hpp>
 #include <apps/animation.hpp>
+#include <apps/benchmarks.hpp>
 // Debug
 #include <lib/assert.hpp>
 // Meta
 #include <meta/defines.hpp>
 
 static Boot::Handoff handoff;
+// the display tasks share a quarter of the CPU so they can't starve
+// the computation they are showing
+static cpu_group_t ui_group;
+#define UI_QUOTA_NS  (25ULL * 1000 * 1000)
+#define UI_PERIOD_NS (100ULL * 1000 * 1000)
 
 static void kernel_print_splash();
 static void kernel_boot_tone();
@@ -62,11 +76,12 @@ static void boot_init(void *boot_info, uint32_t magic)
  * assembly written in boot.S located in arch/i386/boot.S.
  */
 void kernel_main(void *boot_info, uint32_t magic) {
+    // Install the GDT first since it also loads the per-CPU segment,
+    // which has to be in place before anything checks the current task.
+    gdt_install();                  // Initialize the Global Descriptor Table
     // Print the splash screen to show we've booted into the kernel properly.
     kernel_print_splash();
-    // Install the GDT
     interrupts_disable();
-    gdt_install();                  // Initialize the Global Descriptor Table
     isr_install();                  // Initialize Interrupt Service Requests
     rs232::init(RS_232_COM1);        // RS232 Serial
     paging_init(0);                 // Initialize paging service (0 is placeholder)
@@ -89,12 +104,35 @@ void kernel_main(void *boot_info, uint32_t magic) {
     // Print out the CPU vendor info
     rs232::printf("%s\n%s\n", vendor, model);
 
+    fpu_init();                     // Per-task FPU/SSE state
+    idle_init();                    // Idle states (HLT/MWAIT)
     tasks_init();
-    task_t compute, status, spinner, animation;
-    tasks_new(apps::find_primes, &compute, TASK_READY, "prime_compute");
+    rcu_init();
+    hrtimers_init();                // Timers take over the PIT
+    wss_init();                     // Working set estimation
+    workqueue_init(&system_wq, "[kworker]");
+    async_init();                   // Coroutine worker
+    threadpool_init(THREADPOOL_MAX_WORKERS);
+    task_t compute, spinner, animation, schedstat;
+#ifdef BENCHMARKS
+    tasks_new(apps::run_benchmarks, &compute, TASK_READY, "benchmarks");
+#else
+    task_t status;
+    tasks_new(apps::find_primes_parallel, &compute, TASK_READY, "prime_compute");
     tasks_new(apps::show_primes, &status, TASK_READY, "prime_display");
+#endif
     tasks_new(apps::spinner, &spinner, TASK_READY, "spinner");
     tasks_new(apps::testAnimation, &animation, TASK_READY, "testAnimation");
+    tasks_new(schedstat_monitor, &schedstat, TASK_READY, "[schedstat]");
+    tasks_cpu_group_init(&ui_group, "ui", NULL);
+    tasks_cpu_group_set_bandwidth(&ui_group, UI_QUOTA_NS, UI_PERIOD_NS);
+#ifndef BENCHMARKS
+    tasks_cpu_group_attach(&ui_group, &status);
+#endif
+    tasks_cpu_group_attach(&ui_group, &spinner);
+    // only counts if the animation isn't admitted as a deadline task
+    tasks_cpu_group_attach(&ui_group, &animation);
+    top_init(TOP_OUTPUT_VGA);       // CPU usage per task
 
     // Now that we're done make a joyful noise
     kernel_boot_tone();
@@ -262,6 +262,16 @@ bool page_is_present(size_t addr) {
     return mapped_pages.Get(addr >> 12);
 }
 
+page_table_t *get_page_table(uint32_t pde) {
+    if (pde >= PAGE_ENTRIES - 1) return NULL;
+    // skip over tables without a single page mapped in them
+    const size_t words = PAGE_ENTRIES / (sizeof(size_t) * CHAR_BIT);
+    for (size_t i = pde * words; i < (pde + 1) * words; i++) {
+        if (page_map[i] != 0) return &page_tables[pde];
+    }
+    return NULL;
+}
+
 // TODO: maybe enforce access control here in the future
 uint32_t get_phys_page_dir() {
     return page_dir_addr;
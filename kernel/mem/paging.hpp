@@ -30,6 +30,9 @@ extern "C" void invalidate_page(void *page_addr);
 #define PAGE_ENTRY_PRESENT  0x1
 #define PAGE_ENTRY_RW       0x2
 #define PAGE_ENTRY_ACCESS   0x20
+#define PAGE_ENTRY_DIRTY    0x40
+#define PAGE_ENTRY_AVAIL_SHIFT 9     // bits 9-11 are available to software
+#define PAGE_ENTRY_AVAIL_MASK  (0x7 << PAGE_ENTRY_AVAIL_SHIFT)
 #define PAGE_ENTRIES        1024
 #define PAGE_TABLE_SIZE     (sizeof(uint32)*PAGE_ENTRIES)
 #define PAGES_PER_KB(kb)    (PAGE_ALIGN_UP((kb) * 1024) / PAGE_SIZE)
@@ -152,3 +155,14 @@ bool page_is_present(size_t addr);
 uint32_t get_phys_page_dir();
 
 void map_kernel_page(virtual_address_t vaddr, uint32_t paddr);
+
+/**
+ * @brief Gets one of the kernel's page tables for scanning. The entries
+ * may be mapped and unmapped concurrently, so callers that modify them
+ * must do so atomically.
+ *
+ * @param pde Page directory index
+ * @return page_table_t* The page table, or NULL when nothing is mapped
+ * in it (or it is the recursive mapping of the page directory)
+ */
+page_table_t *get_page_table(uint32_t pde);
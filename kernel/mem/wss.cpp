@@ -0,0 +1,155 @@
+/**
+ * @file wss.cpp
+ * @author Panix Contributors
+ * @brief Working set estimation from page table accessed bits
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <mem/wss.hpp>
+#include <mem/paging.hpp>
+#include <sys/tasks.hpp>
+#include <lib/errno.h>
+#include <dev/serial/rs232.hpp>
+#include <arch/arch.hpp>
+
+// estimates of the kernel address space, the only one there is for now
+static wss_stats_t _kernel_stats;
+
+static inline uint32_t _pte_age(uint32_t pte)
+{
+    return (pte & PAGE_ENTRY_AVAIL_MASK) >> PAGE_ENTRY_AVAIL_SHIFT;
+}
+
+/**
+ * @brief Ages a page table entry and clears its accessed bit. The CPU
+ * sets accessed and dirty bits behind our back, so the entry is only
+ * ever updated with a compare and swap.
+ *
+ * @param age Set to the new age of the page
+ * @return uint32_t The entry as it was before, 0 if it is not present
+ */
+static uint32_t _age_entry(page_table_entry_t *entry, uint32_t vaddr, uint32_t *age)
+{
+    uint32_t *raw = (uint32_t *)entry;
+    uint32_t old = __atomic_load_n(raw, __ATOMIC_RELAXED);
+    do {
+        if (!(old & PAGE_ENTRY_PRESENT)) return 0;
+        *age = _pte_age(old);
+        if (old & PAGE_ENTRY_ACCESS) {
+            *age = 0;
+        } else if (*age < WSS_AGE_MAX) {
+            (*age)++;
+        }
+        uint32_t val = (old & ~(PAGE_ENTRY_ACCESS | PAGE_ENTRY_AVAIL_MASK)) |
+            (*age << PAGE_ENTRY_AVAIL_SHIFT);
+        if (val == old) return old;
+        if (__atomic_compare_exchange_n(raw, &old, val, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } while (true);
+    // the TLB caches the entry with the accessed bit set, it has to be
+    // dropped or the CPU will never set the bit again (uniprocessor only,
+    // other CPUs would need a shootdown)
+    if (old & PAGE_ENTRY_ACCESS) invalidate_page((void *)vaddr);
+    return old;
+}
+
+void wss_scan()
+{
+    uint64_t start = tasks_get_time();
+    wss_stats_t stats = { };
+    for (uint32_t pde = 0; pde < PAGE_ENTRIES; pde++) {
+        page_table_t *table = get_page_table(pde);
+        if (table == NULL) continue;
+        for (uint32_t pte = 0; pte < PAGE_ENTRIES; pte++) {
+            uint32_t vaddr = (pde * PAGE_ENTRIES + pte) * PAGE_SIZE;
+            uint32_t age;
+            uint32_t old = _age_entry(&table->pages[pte], vaddr, &age);
+            if (old == 0) continue;
+            stats.mapped++;
+            stats.ages[age]++;
+            if (age < WSS_WINDOW) stats.wss++;
+            if (age == 0) stats.hot++;
+            if (age == WSS_AGE_MAX) stats.cold++;
+            if (old & PAGE_ENTRY_DIRTY) stats.dirty++;
+        }
+    }
+    stats.scan_ns = (uint32_t)(tasks_get_time() - start);
+
+    uint32_t flags = interrupts_save();
+    stats.scans = _kernel_stats.scans + 1;
+    _kernel_stats = stats;
+    interrupts_restore(flags);
+}
+
+int wss_get_stats(uintptr_t page_dir, wss_stats_t *stats)
+{
+    if (page_dir != get_phys_page_dir()) {
+        errno = ENOENT;
+        return -1;
+    }
+    uint32_t flags = interrupts_save();
+    *stats = _kernel_stats;
+    interrupts_restore(flags);
+    return 0;
+}
+
+int wss_task_stats(task_t *task, wss_stats_t *stats)
+{
+    if (task == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    return wss_get_stats(task->page_dir, stats);
+}
+
+size_t wss_cold_pages(uintptr_t *pages, size_t max, uint8_t min_age)
+{
+    size_t found = 0;
+    for (uint32_t pde = 0; pde < PAGE_ENTRIES && found < max; pde++) {
+        page_table_t *table = get_page_table(pde);
+        if (table == NULL) continue;
+        for (uint32_t pte = 0; pte < PAGE_ENTRIES && found < max; pte++) {
+            uint32_t raw = __atomic_load_n((uint32_t *)&table->pages[pte], __ATOMIC_RELAXED);
+            if (!(raw & PAGE_ENTRY_PRESENT) || (raw & PAGE_ENTRY_ACCESS)) continue;
+            if (_pte_age(raw) < min_age) continue;
+            pages[found++] = (pde * PAGE_ENTRIES + pte) * PAGE_SIZE;
+        }
+    }
+    return found;
+}
+
+void wss_dump()
+{
+    wss_stats_t stats;
+    if (wss_get_stats(get_phys_page_dir(), &stats) != 0) {
+        // nothing to show before the first scan
+        rs232::printf("wss kernel not scanned\n");
+        return;
+    }
+    // wss <space> <scans> <mapped> <wss> <hot> <cold> <dirty> <scan ns>
+    rs232::printf("wss kernel %u %u %u %u %u %u %u\n", stats.scans, stats.mapped,
+        stats.wss, stats.hot, stats.cold, stats.dirty, stats.scan_ns);
+    // age <space> <scans since accessed>:<pages>...
+    rs232::printf("age kernel");
+    for (size_t i = 0; i <= WSS_AGE_MAX; i++) {
+        if (stats.ages[i] != 0) rs232::printf(" %u:%u", i, stats.ages[i]);
+    }
+    rs232::printf("\n");
+}
+
+static void _wss_scanner()
+{
+    uint64_t next = tasks_get_time();
+    for (;;) {
+        wss_scan();
+        next += WSS_SCAN_INTERVAL_NS;
+        tasks_nano_sleep_until(next);
+    }
+}
+
+void wss_init()
+{
+    tasks_new(_wss_scanner, NULL, TASK_READY, "[wss]");
+}
@@ -0,0 +1,85 @@
+/**
+ * @file wss.hpp
+ * @author Panix Contributors
+ * @brief Working set estimation. A kernel task periodically walks the
+ * page tables, samples and clears the accessed bit of every present
+ * page and keeps an age per page (scans since it was last accessed) in
+ * the bits of the page table entry that are available to software.
+ * From those ages it derives the working set size and hot/cold page
+ * counts of each address space.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// time between two scans of an address space
+#define WSS_SCAN_INTERVAL_NS (1000ULL * 1000 * 1000)
+// ages saturate here, pages of this age are considered cold
+#define WSS_AGE_MAX     7
+// pages accessed within this many scans make up the working set
+#define WSS_WINDOW      4
+
+typedef struct wss_stats
+{
+    uint32_t scans;         // completed scans of the address space
+    uint32_t mapped;        // present pages
+    uint32_t wss;           // pages accessed within the last WSS_WINDOW scans
+    uint32_t hot;           // pages accessed since the previous scan
+    uint32_t cold;          // pages not accessed for WSS_AGE_MAX scans
+    uint32_t dirty;         // pages written to since they were mapped
+    uint32_t scan_ns;       // how long the last scan took
+    uint32_t ages[WSS_AGE_MAX + 1];
+} wss_stats_t;
+
+struct task;
+
+/**
+ * @brief Starts the scanner task.
+ *
+ */
+void wss_init();
+/**
+ * @brief Scans the kernel address space once, ageing every present
+ * page and clearing its accessed bit. Normally only called by the
+ * scanner task.
+ *
+ */
+void wss_scan();
+/**
+ * @brief Gets the estimates for an address space, as of the last scan.
+ *
+ * @param page_dir Physical address of the page directory
+ * @param stats Where to store the estimates
+ * @return int Returns 0 on success and -1 with errno set to ENOENT
+ * if the address space is not scanned
+ */
+int wss_get_stats(uintptr_t page_dir, wss_stats_t *stats);
+/**
+ * @brief Gets the estimates for the address space a task runs in.
+ * Kernel tasks all share one address space and so report the same.
+ *
+ * @param task Task to look up
+ * @param stats Where to store the estimates
+ * @return int Returns 0 on success and -1 with errno set on failure
+ */
+int wss_task_stats(struct task *task, wss_stats_t *stats);
+/**
+ * @brief Finds pages that have not been accessed for a while.
+ *
+ * @param pages Buffer for the virtual addresses of the pages
+ * @param max Size of the buffer
+ * @param min_age Number of scans a page must have gone unaccessed
+ * @return size_t Number of pages stored
+ */
+size_t wss_cold_pages(uintptr_t *pages, size_t max, uint8_t min_age);
+/**
+ * @brief Prints the estimates over serial.
+ *
+ */
+void wss_dump();
@@ -0,0 +1,183 @@
+/**
+ * @file async.cpp
+ * @author Panix Contributors
+ * @brief Coroutine based async execution
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/async.hpp>
+#include <mem/heap.hpp>
+#include <lib/errno.h>
+#include <arch/arch.hpp>
+
+// every coroutine runs on this queue's worker
+static workqueue_t _async_wq;
+static async_stats_t _stats;
+
+void async_init()
+{
+    workqueue_init(&_async_wq, "[async]");
+}
+
+async_stats_t async_get_stats()
+{
+    uint32_t flags = interrupts_save();
+    async_stats_t stats = _stats;
+    interrupts_restore(flags);
+    return stats;
+}
+
+void *async_frame_alloc(size_t size)
+{
+    void *frame = malloc(size);
+    if (frame == NULL) return NULL;
+    uint32_t flags = interrupts_save();
+    _stats.live++;
+    _stats.frame_bytes += size;
+    if (size > _stats.max_frame) _stats.max_frame = size;
+    interrupts_restore(flags);
+    return frame;
+}
+
+void async_frame_free(void *frame, size_t size)
+{
+    uint32_t flags = interrupts_save();
+    _stats.live--;
+    _stats.frame_bytes -= size;
+    interrupts_restore(flags);
+    free(frame);
+}
+
+static void _resume(void *data)
+{
+    _stats.resumes++;
+    std::coroutine_handle<>::from_address(data).resume();
+}
+
+void async_resume_later(work_t *work, std::coroutine_handle<> handle)
+{
+    work_init(work, _resume, handle.address());
+    workqueue_queue(&_async_wq, work);
+}
+
+int async_spawn(Async<void>&& task)
+{
+    if (!task.Valid()) {
+        errno = ENOMEM;
+        return -1;
+    }
+    Async<void>::handle_type handle = task.Release();
+    handle.promise().detached = true;
+    uint32_t flags = interrupts_save();
+    _stats.spawned++;
+    interrupts_restore(flags);
+    async_resume_later(&handle.promise().start, handle);
+    return 0;
+}
+
+void AsyncSleep::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    waiter = handle;
+    hrtimer_init(&timer, Expired, this, HRTIMER_MODE_HARD);
+    hrtimer_start(&timer, deadline, 0);
+}
+
+void AsyncSleep::Expired(hrtimer_t* timer)
+{
+    AsyncSleep* sleep = (AsyncSleep*)timer->data;
+    async_resume_later(&sleep->resume, sleep->waiter);
+}
+
+bool AsyncWait::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    waiter = handle;
+    entry.notify = Notified;
+    entry.data = this;
+    work_init(&retry, Retry, this);
+    // notifications are sent with interrupts disabled, so none can
+    // slip in between the check and the registration
+    uint32_t flags = interrupts_save();
+    if (take(arg)) {
+        interrupts_restore(flags);
+        return false;
+    }
+    waitable_add(waitable, &entry);
+    interrupts_restore(flags);
+    return true;
+}
+
+void AsyncWait::Notified(poll_entry_t* entry)
+{
+    // the object may only be taken in task context, so that is left
+    // to the worker
+    AsyncWait* wait = (AsyncWait*)entry->data;
+    waitable_remove(wait->waitable, entry);
+    workqueue_queue(&_async_wq, &wait->retry);
+}
+
+void AsyncWait::Retry(void* data)
+{
+    AsyncWait* wait = (AsyncWait*)data;
+    uint32_t flags = interrupts_save();
+    if (!wait->take(wait->arg)) {
+        // someone else got there first, wait for the next notification
+        waitable_add(wait->waitable, &wait->entry);
+        interrupts_restore(flags);
+        return;
+    }
+    interrupts_restore(flags);
+    _stats.resumes++;
+    wait->waiter.resume();
+}
+
+static bool _waitable_ready(void *arg)
+{
+    waitable_t *waitable = (waitable_t *)arg;
+    return waitable->ready(waitable->owner);
+}
+
+static bool _sem_take(void *arg)
+{
+    return ((Semaphore *)arg)->TryWait() == 0;
+}
+
+static bool _completion_ready(void *arg)
+{
+    async_completion_t *completion = (async_completion_t *)arg;
+    return __atomic_load_n(&completion->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+AsyncWait async_wait(waitable_t *waitable)
+{
+    return AsyncWait(waitable, _waitable_ready, waitable);
+}
+
+AsyncWait async_wait(Semaphore &sem)
+{
+    return AsyncWait(sem.Waitable(), _sem_take, &sem);
+}
+
+AsyncWait async_wait(async_completion_t *completion)
+{
+    return AsyncWait(&completion->waitable, _completion_ready, completion);
+}
+
+void async_completion_init(async_completion_t *completion)
+{
+    waitable_init(&completion->waitable, _completion_ready, completion);
+    completion->done = 0;
+}
+
+void async_complete(async_completion_t *completion)
+{
+    __atomic_store_n(&completion->done, 1, __ATOMIC_RELEASE);
+    waitable_notify(&completion->waitable);
+}
+
+void async_completion_reset(async_completion_t *completion)
+{
+    __atomic_store_n(&completion->done, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,322 @@
+/**
+ * @file async.hpp
+ * @author Panix Contributors
+ * @brief Coroutine based async execution. An Async<T> is a C++20
+ * coroutine that keeps its state in a small heap frame instead of on a
+ * task stack, so simple state machines (I/O, timeouts, device protocols)
+ * don't each need a task. Coroutines run on the [async] worker task and
+ * give it up at every co_await that has to wait:
+ *
+ *     Async<void> blink(Semaphore &stop)
+ *     {
+ *         while (stop.TryWait() != 0) {
+ *             toggle();
+ *             co_await async_sleep(500ULL * 1000 * 1000);
+ *         }
+ *     }
+ *     async_spawn(blink(stop));
+ *
+ * Coroutines must not block the worker (no Mutex::Lock(), Semaphore::Wait()
+ * or sleeps), they co_await instead.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <lib/coroutine.hpp>
+#include <lib/semaphore.hpp>
+#include <sys/tasks.hpp>
+#include <sys/hrtimer.hpp>
+#include <sys/waitable.hpp>
+#include <sys/workqueue.hpp>
+#include <sys/panic.hpp>
+
+typedef struct async_stats
+{
+    uint32_t spawned;       // coroutines started with async_spawn()
+    uint32_t live;          // coroutine frames currently allocated
+    uint32_t frame_bytes;   // bytes held by those frames
+    uint32_t max_frame;     // largest frame allocated so far
+    uint32_t resumes;       // coroutines resumed by the worker
+} async_stats_t;
+
+/**
+ * @brief Starts the [async] worker task. Must be called after
+ * tasks_init(). Coroutines spawned before then start once it runs.
+ *
+ */
+void async_init();
+/**
+ * @brief Gets the coroutine counters.
+ *
+ * @return async_stats_t Snapshot of the counters
+ */
+async_stats_t async_get_stats();
+/**
+ * @brief Resumes a suspended coroutine on the [async] worker. Safe to
+ * call from any context. Used by awaiters to wake their coroutine.
+ *
+ * @param work Work item owned by the awaiter
+ * @param handle Coroutine to resume
+ */
+void async_resume_later(work_t *work, std::coroutine_handle<> handle);
+
+// Frame allocation for Async<T>, not for use elsewhere
+void *async_frame_alloc(size_t size);
+void async_frame_free(void *frame, size_t size);
+
+template <typename T = void>
+class Async;
+
+namespace async_detail {
+
+struct PromiseBase {
+    // coroutine waiting for this one to finish
+    std::coroutine_handle<> continuation;
+    // frees itself when done, nobody awaits it
+    bool detached = false;
+    // starts a spawned coroutine on the worker
+    work_t start;
+
+    // coroutines start suspended and are run by whoever awaits
+    // or spawns them
+    std::suspend_always initial_suspend() noexcept { return { }; }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            PromiseBase& promise = handle.promise();
+            if (promise.continuation) {
+                // go straight back to the awaiting coroutine instead
+                // of returning through the worker
+                return promise.continuation;
+            }
+            if (promise.detached) {
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept { }
+    };
+    FinalAwaiter final_suspend() noexcept { return { }; }
+
+    // exceptions are disabled
+    void unhandled_exception() { }
+
+    // the allocation can fail without exceptions, in which case the
+    // call returns an invalid Async (see get_return_object_on_allocation_failure)
+    static void* operator new(size_t size) noexcept { return async_frame_alloc(size); }
+    static void operator delete(void* frame, size_t size) { async_frame_free(frame, size); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    T value;
+    void return_value(T result) { value = result; }
+    T result() { return value; }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    void return_void() { }
+    void result() { }
+};
+
+}
+
+/**
+ * @brief A coroutine returning T. It doesn't run until it is either
+ * awaited by another coroutine (co_await returns its result) or handed
+ * to async_spawn(). T must be default constructible.
+ *
+ */
+template <typename T>
+class Async {
+public:
+    struct promise_type : async_detail::Promise<T> {
+        Async get_return_object() noexcept
+        {
+            return Async(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        static Async get_return_object_on_allocation_failure() noexcept
+        {
+            return Async(nullptr);
+        }
+    };
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Async(Async&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Async(const Async&) = delete;
+    Async& operator=(const Async&) = delete;
+    ~Async()
+    {
+        if (handle) handle.destroy();
+    }
+
+    /**
+     * @brief Checks whether the coroutine frame could be allocated.
+     *
+     * @return true The coroutine can be awaited or spawned
+     */
+    bool Valid() const { return (bool)handle; }
+    /**
+     * @brief Gives up ownership of the coroutine frame.
+     *
+     * @return handle_type The coroutine
+     */
+    handle_type Release()
+    {
+        handle_type released = handle;
+        handle = nullptr;
+        return released;
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        if (!handle) {
+            PANIC("Awaited a coroutine that could not be allocated.\n");
+        }
+        handle.promise().continuation = awaiting;
+        // run the child right away, it comes back here when it is done
+        return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+
+private:
+    explicit Async(handle_type coroutine) : handle(coroutine) { }
+    handle_type handle;
+};
+
+/**
+ * @brief Runs a coroutine on the [async] worker without waiting for it.
+ * Its frame is freed when it finishes. Safe to call from any context.
+ *
+ * @param task Coroutine to run
+ * @return int Returns 0 on success and -1 with errno set to ENOMEM if
+ * the coroutine's frame could not be allocated.
+ */
+int async_spawn(Async<void>&& task);
+
+/**
+ * @brief Awaiter that resumes the coroutine at an absolute time.
+ *
+ */
+class AsyncSleep {
+public:
+    explicit AsyncSleep(uint64_t when) : deadline(when) { }
+    AsyncSleep(const AsyncSleep&) = delete;
+    bool await_ready() const noexcept { return tasks_get_time() >= deadline; }
+    void await_suspend(std::coroutine_handle<> handle) noexcept;
+    void await_resume() const noexcept { }
+
+private:
+    static void Expired(hrtimer_t* timer);
+
+    uint64_t deadline;
+    std::coroutine_handle<> waiter;
+    hrtimer_t timer;
+    work_t resume;
+};
+
+/**
+ * @brief Awaiter that resumes the coroutine once it could take an
+ * object, see async_wait().
+ *
+ */
+class AsyncWait {
+public:
+    AsyncWait(waitable_t* object, bool (*try_take)(void* arg), void* take_arg)
+        : waitable(object), take(try_take), arg(take_arg) { }
+    AsyncWait(const AsyncWait&) = delete;
+    bool await_ready() const noexcept { return take(arg); }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept;
+    void await_resume() const noexcept { }
+
+private:
+    static void Notified(poll_entry_t* entry);
+    static void Retry(void* data);
+
+    waitable_t* waitable;
+    bool (*take)(void* arg);
+    void* arg;
+    std::coroutine_handle<> waiter;
+    poll_entry_t entry;
+    work_t retry;
+};
+
+/**
+ * @brief An event that a driver completes once, typically from its
+ * interrupt handler, and that tasks and coroutines wait for.
+ *
+ */
+typedef struct async_completion
+{
+    waitable_t waitable;
+    uint32_t done;
+} async_completion_t;
+
+/**
+ * @brief Initializes a completion as not done.
+ *
+ * @param completion Completion to initialize
+ */
+void async_completion_init(async_completion_t *completion);
+/**
+ * @brief Marks a completion as done and wakes everyone waiting for it.
+ * Safe to call from any context.
+ *
+ * @param completion Completion to complete
+ */
+void async_complete(async_completion_t *completion);
+/**
+ * @brief Makes a completion not done again, so it can be reused for
+ * the next operation.
+ *
+ * @param completion Completion to reset
+ */
+void async_completion_reset(async_completion_t *completion);
+
+/**
+ * @brief Suspends the coroutine for the given time.
+ *
+ * @param ns Nanoseconds to sleep for
+ */
+static inline AsyncSleep async_sleep(uint64_t ns)
+{
+    return AsyncSleep(tasks_get_time() + ns);
+}
+/**
+ * @brief Suspends the coroutine until an absolute time.
+ *
+ * @param deadline Time to resume at (nanoseconds since boot)
+ */
+static inline AsyncSleep async_sleep_until(uint64_t deadline)
+{
+    return AsyncSleep(deadline);
+}
+/**
+ * @brief Suspends the coroutine until the object is ready.
+ *
+ * @param waitable Object to wait for
+ */
+AsyncWait async_wait(waitable_t *waitable);
+/**
+ * @brief Suspends the coroutine until it has taken the semaphore.
+ *
+ * @param sem Semaphore to take
+ */
+AsyncWait async_wait(Semaphore &sem);
+/**
+ * @brief Suspends the coroutine until the completion is done.
+ *
+ * @param completion Completion to wait for
+ */
+AsyncWait async_wait(async_completion_t *completion);
@@ -0,0 +1,233 @@
+/**
+ * @file hrtimer.cpp
+ * @author Panix Contributors
+ * @brief High resolution timers driven by a clock event device
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/hrtimer.hpp>
+#include <sys/softirq.hpp>
+#include <sys/tasks.hpp>
+#include <sys/panic.hpp>
+#include <arch/arch.hpp>
+
+// pending timers, earliest expiry first
+static hrtimer_t *_queue = NULL;
+// expired soft timers waiting for the softirq
+static hrtimer_t *_soft_head = NULL;
+static hrtimer_t *_soft_tail = NULL;
+// the device driving the timers and whether it runs in one-shot mode
+static clock_event_device_t *_dev = NULL;
+static bool _oneshot = false;
+// expiry the device is currently programmed for
+static uint64_t _next_event = UINT64_MAX;
+// keeps timer_tick going once the device is no longer periodic
+static hrtimer_t _tick_timer;
+
+static void _enqueue(hrtimer_t *timer)
+{
+    // FIFO among timers that expire at the same time
+    hrtimer_t **link = &_queue;
+    while (*link != NULL && (*link)->expires <= timer->expires) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+    timer->state = HRTIMER_STATE_QUEUED;
+}
+
+static bool _unlink(hrtimer_t **head, hrtimer_t **tail, hrtimer_t *timer)
+{
+    hrtimer_t *pre = NULL;
+    for (hrtimer_t **link = head; *link != NULL; pre = *link, link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            if (tail != NULL && *tail == timer) *tail = pre;
+            timer->next = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool _dequeue(hrtimer_t *timer)
+{
+    switch (timer->state) {
+        case HRTIMER_STATE_QUEUED:
+            _unlink(&_queue, NULL, timer);
+            break;
+        case HRTIMER_STATE_EXPIRED:
+            _unlink(&_soft_head, &_soft_tail, timer);
+            break;
+        default:
+            return false;
+    }
+    timer->state = HRTIMER_STATE_INACTIVE;
+    return true;
+}
+
+static void _forward(hrtimer_t *timer, uint64_t now)
+{
+    timer->expires += timer->period;
+    if (timer->expires <= now) {
+        // skip the periods that were missed entirely
+        timer->expires += timer->period * ((now - timer->expires) / timer->period + 1);
+    }
+}
+
+static void _program(uint64_t now)
+{
+    // a device that is already set to go off no later than the earliest
+    // timer is left alone, an early interrupt just reprograms it
+    if (!_oneshot || _queue == NULL || _queue->expires >= _next_event) {
+        return;
+    }
+    uint64_t delta = _queue->expires > now ? _queue->expires - now : 0;
+    if (delta < _dev->min_delta_ns) delta = _dev->min_delta_ns;
+    if (delta > _dev->max_delta_ns) delta = _dev->max_delta_ns;
+    _next_event = now + delta;
+    _dev->set_next_event(_dev, delta);
+}
+
+static void _run_queue()
+{
+    for (;;) {
+        uint32_t flags = interrupts_save();
+        uint64_t now = tasks_get_time();
+        hrtimer_t *timer = _queue;
+        if (timer == NULL || timer->expires > now) {
+            _program(now);
+            interrupts_restore(flags);
+            break;
+        }
+        _queue = timer->next;
+        timer->next = NULL;
+        if (timer->mode == HRTIMER_MODE_SOFT) {
+            // the softirq re-arms it once the callback has run
+            timer->state = HRTIMER_STATE_EXPIRED;
+            if (_soft_tail != NULL) {
+                _soft_tail->next = timer;
+            } else {
+                _soft_head = timer;
+            }
+            _soft_tail = timer;
+            softirq_raise(SOFTIRQ_HRTIMER);
+            interrupts_restore(flags);
+            continue;
+        }
+        if (timer->period != 0) {
+            _forward(timer, now);
+            _enqueue(timer);
+        } else {
+            timer->state = HRTIMER_STATE_INACTIVE;
+        }
+        // the callback may switch to another task, so the device has
+        // to be set up for the next timer before it gets to run
+        _program(now);
+        interrupts_restore(flags);
+        timer->func(timer);
+    }
+}
+
+static void _hrtimer_interrupt(clock_event_device_t *dev)
+{
+    (void)dev;
+    // whatever the device was programmed for has happened
+    _next_event = UINT64_MAX;
+    _run_queue();
+}
+
+static void _run_soft()
+{
+    for (;;) {
+        uint32_t flags = interrupts_save();
+        hrtimer_t *timer = _soft_head;
+        if (timer == NULL) {
+            interrupts_restore(flags);
+            break;
+        }
+        _soft_head = timer->next;
+        if (_soft_head == NULL) _soft_tail = NULL;
+        timer->next = NULL;
+        if (timer->period != 0) {
+            uint64_t now = tasks_get_time();
+            _forward(timer, now);
+            _enqueue(timer);
+            _program(now);
+        } else {
+            timer->state = HRTIMER_STATE_INACTIVE;
+        }
+        interrupts_restore(flags);
+        timer->func(timer);
+    }
+}
+
+static void _tick(hrtimer_t *timer)
+{
+    (void)timer;
+    timer_do_tick();
+}
+
+void hrtimers_init()
+{
+    softirq_register(SOFTIRQ_HRTIMER, _run_soft);
+    hrtimer_init(&_tick_timer, _tick, NULL, HRTIMER_MODE_HARD);
+    uint32_t flags = interrupts_save();
+    _dev = clockevents_best();
+    if (_dev == NULL) {
+        PANIC("No clock event device to drive the timers.\n");
+    }
+    _dev->event_handler = _hrtimer_interrupt;
+    if (_dev->features & CLOCK_EVT_FEAT_ONESHOT) {
+        _oneshot = true;
+    } else {
+        // without one-shot mode timers expire on the next periodic interrupt
+        _dev->set_periodic(_dev, timer_period_ns());
+    }
+    uint64_t period = timer_period_ns();
+    hrtimer_start(&_tick_timer, tasks_get_time() + period, period);
+    interrupts_restore(flags);
+}
+
+void hrtimer_init(hrtimer_t *timer, void (*func)(hrtimer_t *), void *data, hrtimer_mode mode)
+{
+    *timer = {
+        .next = NULL,
+        .expires = 0,
+        .period = 0,
+        .func = func,
+        .data = data,
+        .mode = mode,
+        .state = HRTIMER_STATE_INACTIVE,
+    };
+}
+
+void hrtimer_start(hrtimer_t *timer, uint64_t expires, uint64_t period)
+{
+    uint32_t flags = interrupts_save();
+    _dequeue(timer);
+    timer->expires = expires;
+    timer->period = period;
+    _enqueue(timer);
+    _program(tasks_get_time());
+    interrupts_restore(flags);
+}
+
+bool hrtimer_cancel(hrtimer_t *timer)
+{
+    uint32_t flags = interrupts_save();
+    bool pending = _dequeue(timer);
+    interrupts_restore(flags);
+    return pending;
+}
+
+uint64_t hrtimer_next_expiry()
+{
+    uint32_t flags = interrupts_save();
+    uint64_t expires = _queue != NULL ? _queue->expires : UINT64_MAX;
+    interrupts_restore(flags);
+    return expires;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file hrtimer.hpp
+ * @author Panix Contributors
+ * @brief High resolution timers. Timers expire at an absolute time in
+ * nanoseconds (as returned by tasks_get_time()), once or periodically,
+ * and are kept ordered by expiry. The best clock event device is run in
+ * one-shot mode and programmed for the earliest timer, so expiry isn't
+ * tied to the tick rate.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum hrtimer_mode
+{
+    HRTIMER_MODE_HARD = 0,  // the callback runs in interrupt context
+    HRTIMER_MODE_SOFT,      // the callback runs in softirq context
+};
+
+enum hrtimer_state
+{
+    HRTIMER_STATE_INACTIVE = 0,
+    HRTIMER_STATE_QUEUED,   // waiting to expire
+    HRTIMER_STATE_EXPIRED,  // waiting for the softirq to run the callback
+};
+
+typedef struct hrtimer hrtimer_t;
+struct hrtimer
+{
+    hrtimer_t *next;
+    uint64_t expires;       // absolute expiry time (nanoseconds since boot)
+    uint64_t period;        // re-armed this much later after expiring, 0 for one-shot
+    void (*func)(hrtimer_t *timer);
+    void *data;
+    hrtimer_mode mode;
+    hrtimer_state state;
+};
+
+/**
+ * @brief Initializes the timer subsystem and takes over the best clock
+ * event device. Must be called after tasks_init().
+ *
+ */
+void hrtimers_init();
+/**
+ * @brief Initializes a timer. Hard callbacks run with interrupts disabled
+ * and must be short. Neither kind may block. A callback may start or
+ * cancel its own timer.
+ *
+ * @param timer Timer to initialize
+ * @param func Function called when the timer expires
+ * @param data Pointer for the callback's use
+ * @param mode Context the callback runs in
+ */
+void hrtimer_init(hrtimer_t *timer, void (*func)(hrtimer_t *), void *data, hrtimer_mode mode);
+/**
+ * @brief Arms a timer, or re-arms it if it is already pending. Safe to
+ * call from any context.
+ *
+ * @param timer Timer to arm
+ * @param expires Absolute expiry time (nanoseconds since boot)
+ * @param period Nanoseconds between expiries of a periodic timer,
+ * or 0 for a one-shot timer
+ */
+void hrtimer_start(hrtimer_t *timer, uint64_t expires, uint64_t period);
+/**
+ * @brief Disarms a timer. Safe to call from any context.
+ *
+ * @param timer Timer to disarm
+ * @return true The timer was pending and won't run now
+ * @return false The timer was not pending
+ */
+bool hrtimer_cancel(hrtimer_t *timer);
+/**
+ * @brief Gets the expiry of the earliest pending timer, which is when
+ * the CPU is woken next unless another interrupt comes first.
+ *
+ * @return uint64_t Absolute expiry time, or UINT64_MAX if no timer is pending
+ */
+uint64_t hrtimer_next_expiry();
+/**
+ * @brief Checks whether a timer is pending.
+ *
+ * @param timer Timer to check
+ * @return true The timer is armed and its callback hasn't run yet
+ */
+static inline bool hrtimer_active(const hrtimer_t *timer)
+{
+    return timer->state != HRTIMER_STATE_INACTIVE;
+}
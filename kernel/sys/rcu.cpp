@@ -0,0 +1,135 @@
+/**
+ * @file rcu.cpp
+ * @author Panix Contributors
+ * @brief Read-copy-update style deferred reclamation
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/rcu.hpp>
+#include <sys/softirq.hpp>
+#include <arch/arch.hpp>
+
+// CPUs that have to pass a quiescent state for a grace period to end
+// (there is only ever the boot CPU for now)
+#define RCU_CPUS_ONLINE 0x1U
+
+static uint32_t _gp_seq = 0;          // last grace period started
+static uint32_t _gp_completed = 0;    // last grace period that ended
+static uint32_t _gp_cpus_pending = 0; // CPUs yet to report in the current one
+
+static void _rcu_process_callbacks();
+
+static inline bool _gp_in_progress()
+{
+    return _gp_seq != _gp_completed;
+}
+
+static inline bool _gp_done(uint32_t gp)
+{
+    // wraparound safe version of _gp_completed >= gp
+    return (int32_t)(_gp_completed - gp) >= 0;
+}
+
+void rcu_init()
+{
+    softirq_register(SOFTIRQ_RCU, _rcu_process_callbacks);
+}
+
+static void _start_gp()
+{
+    _gp_seq++;
+    _gp_cpus_pending = RCU_CPUS_ONLINE;
+}
+
+void rcu_note_qs()
+{
+    cpu_local_t *cpu = this_cpu();
+    // only the first quiescent state after a grace period starts counts
+    if (!_gp_in_progress() || cpu->rcu_qs_gp == _gp_seq) {
+        return;
+    }
+    cpu->rcu_qs_gp = _gp_seq;
+    _gp_cpus_pending &= ~(1U << cpu->id);
+    if (_gp_cpus_pending == 0) {
+        _gp_completed = _gp_seq;
+        // the callbacks are invoked on the way out of the next interrupt
+        softirq_raise(SOFTIRQ_RCU);
+    }
+}
+
+static void _rcu_process_callbacks()
+{
+    rcu_head_t *done = NULL;
+    uint32_t flags = interrupts_save();
+    cpu_local_t *cpu = this_cpu();
+    // callbacks whose grace period has ended are ready to go
+    if (cpu->rcu_wait_head != NULL && _gp_done(cpu->rcu_wait_gp)) {
+        done = cpu->rcu_wait_head;
+        cpu->rcu_wait_head = NULL;
+        cpu->rcu_wait_tail = NULL;
+    }
+    // newer callbacks have to wait for a grace period that starts after
+    // they were queued (one that is already in progress doesn't count)
+    if (cpu->rcu_wait_head == NULL && cpu->rcu_next_head != NULL) {
+        cpu->rcu_wait_head = cpu->rcu_next_head;
+        cpu->rcu_wait_tail = cpu->rcu_next_tail;
+        cpu->rcu_next_head = NULL;
+        cpu->rcu_next_tail = NULL;
+        cpu->rcu_wait_gp = _gp_seq + 1;
+    }
+    if (cpu->rcu_wait_head != NULL && !_gp_in_progress() && !_gp_done(cpu->rcu_wait_gp)) {
+        _start_gp();
+    }
+    interrupts_restore(flags);
+
+    while (done != NULL) {
+        rcu_head_t *next = done->next;
+        done->func(done);
+        done = next;
+    }
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head))
+{
+    head->next = NULL;
+    head->func = func;
+    uint32_t flags = interrupts_save();
+    cpu_local_t *cpu = this_cpu();
+    if (cpu->rcu_next_tail != NULL) {
+        cpu->rcu_next_tail->next = head;
+    } else {
+        cpu->rcu_next_head = head;
+    }
+    cpu->rcu_next_tail = head;
+    softirq_raise(SOFTIRQ_RCU);
+    interrupts_restore(flags);
+}
+
+typedef struct rcu_sync
+{
+    rcu_head_t head;    // must be first
+    uint32_t done;
+    tasks_sync_t waiter;
+} rcu_sync_t;
+
+static void _rcu_sync_done(rcu_head_t *head)
+{
+    rcu_sync_t *sync = (rcu_sync_t *)head;
+    __atomic_store_n(&sync->done, 1, __ATOMIC_RELEASE);
+    tasks_sync_wake_one(&sync->waiter);
+}
+
+void synchronize_rcu()
+{
+    rcu_sync_t sync;
+    sync.done = 0;
+    tasks_sync_init(&sync.waiter);
+    sync.waiter.dbg_name = "synchronize_rcu";
+    call_rcu(&sync.head, _rcu_sync_done);
+    while (!__atomic_load_n(&sync.done, __ATOMIC_ACQUIRE)) {
+        tasks_sync_wait(&sync.waiter, &sync.done, 0);
+    }
+}
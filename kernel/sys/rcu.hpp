@@ -0,0 +1,87 @@
+/**
+ * @file rcu.hpp
+ * @author Panix Contributors
+ * @brief Read-copy-update style deferred reclamation. Readers run without
+ * locks between rcu_read_lock() and rcu_read_unlock() and must not block.
+ * Writers unpublish an object, then free it with call_rcu() (or after
+ * synchronize_rcu()) once every reader that might still see it is done.
+ * A grace period ends once every CPU has passed through the scheduler,
+ * since a context switch can't happen inside a read section.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/tasks.hpp>
+
+typedef struct rcu_head rcu_head_t;
+struct rcu_head
+{
+    rcu_head_t *next;
+    void (*func)(rcu_head_t *head);
+};
+
+/**
+ * @brief Publishes a pointer to readers. Everything written to the
+ * object beforehand is visible to a reader that sees the new pointer.
+ *
+ */
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+/**
+ * @brief Loads a pointer published with rcu_assign_pointer() for use
+ * inside a read section.
+ *
+ */
+#define rcu_dereference(p) __atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+/**
+ * @brief Starts a read section. Read sections may nest and may be
+ * used from interrupt context, but must never block.
+ *
+ */
+static inline void rcu_read_lock()
+{
+    // no context switch means no quiescent state on this CPU
+    preempt_disable();
+}
+/**
+ * @brief Ends a read section.
+ *
+ */
+static inline void rcu_read_unlock()
+{
+    preempt_enable();
+}
+
+/**
+ * @brief Initializes RCU. Must be called after tasks_init().
+ *
+ */
+void rcu_init();
+/**
+ * @brief Calls func(head) once a full grace period has passed, so that no
+ * reader can still hold a reference to the object head is embedded in.
+ * The callback runs in softirq context and must not block. Safe to call
+ * from any context.
+ *
+ * @param head Head embedded in the object being reclaimed
+ * @param func Reclamation function
+ */
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+/**
+ * @brief Blocks until a full grace period has passed. Must not be called
+ * from interrupt context or inside a read section.
+ *
+ */
+void synchronize_rcu();
+/**
+ * @brief Reports a quiescent state for this CPU. Called by the scheduler
+ * with the scheduler lock held.
+ *
+ */
+void rcu_note_qs();
@@ -0,0 +1,184 @@
+/**
+ * @file schedstat.cpp
+ * @author Panix Contributors
+ * @brief Scheduler latency tracing
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/schedstat.hpp>
+#include <sys/tasks.hpp>
+#include <sys/waitable.hpp>
+#include <sys/top.hpp>
+#include <mem/wss.hpp>
+#include <lib/string.hpp>
+#include <lib/spinlock.hpp>
+#include <dev/serial/rs232.hpp>
+#include <arch/arch.hpp>
+
+static sched_stats_t _global;
+static uint32_t _depth[SCHEDSTAT_DEPTH_BUCKETS];
+
+static void _log_hist_add(sched_log_hist_t *hist, uint64_t value)
+{
+    uint32_t ns = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+    hist->count++;
+    hist->buckets[31 - __builtin_clz(ns | 1)]++;
+    if (ns > hist->max) hist->max = ns;
+}
+
+void schedstat_switch_out(struct task *task, bool voluntary, uint64_t ran)
+{
+    size_t slice = (size_t)((ran * 10) / TIME_SLICE_SIZE);
+    if (slice >= SCHEDSTAT_SLICE_BUCKETS) slice = SCHEDSTAT_SLICE_BUCKETS - 1;
+    sched_stats_t *stats[2] = { &_global, &task->sched_stats.stats };
+    for (sched_stats_t *s : stats) {
+        s->slice_use[slice]++;
+        if (voluntary) {
+            s->nr_voluntary++;
+        } else {
+            s->nr_involuntary++;
+        }
+    }
+}
+
+void schedstat_switch_in(struct task *task, uint64_t latency, size_t depth)
+{
+    if (latency != UINT64_MAX) {
+        _log_hist_add(&_global.wakeup_latency, latency);
+        _log_hist_add(&task->sched_stats.stats.wakeup_latency, latency);
+    }
+    if (depth >= SCHEDSTAT_DEPTH_BUCKETS) depth = SCHEDSTAT_DEPTH_BUCKETS - 1;
+    _depth[depth]++;
+}
+
+static void _reset_task(task_t *task, void *arg)
+{
+    (void)arg;
+    memset(&task->sched_stats.stats, 0, sizeof(task->sched_stats.stats));
+}
+
+void schedstat_reset()
+{
+    uint32_t flags = interrupts_save();
+    memset(&_global, 0, sizeof(_global));
+    memset(_depth, 0, sizeof(_depth));
+    interrupts_restore(flags);
+    tasks_irqoff_reset();
+    irqsoff_reset();
+    tasks_for_each(_reset_task, NULL);
+}
+
+static void _print_stats(const char *name, const sched_stats_t *stats)
+{
+    // sched <name> <voluntary> <involuntary>
+    rs232::printf("sched %s %u %u\n", name, stats->nr_voluntary, stats->nr_involuntary);
+    // lat <name> <count> <max ns> <log2 bucket>:<count>...
+    const sched_log_hist_t *lat = &stats->wakeup_latency;
+    rs232::printf("lat %s %u %u", name, lat->count, lat->max);
+    for (size_t i = 0; i < SCHEDSTAT_LOG_BUCKETS; i++) {
+        if (lat->buckets[i] != 0) rs232::printf(" %u:%u", i, lat->buckets[i]);
+    }
+    // slice <name> <percent of slice>:<count>...
+    rs232::printf("\nslice %s", name);
+    for (size_t i = 0; i < SCHEDSTAT_SLICE_BUCKETS; i++) {
+        if (stats->slice_use[i] != 0) rs232::printf(" %u:%u", i * 10, stats->slice_use[i]);
+    }
+    rs232::printf("\n");
+}
+
+// tasks copied out by one schedstat_dump(), any beyond that are skipped
+#define SCHEDSTAT_MAX_TASKS 32
+
+typedef struct schedstat_task
+{
+    const char *name;
+    sched_stats_t stats;
+} schedstat_task_t;
+
+typedef struct schedstat_copy
+{
+    size_t count;
+    size_t skipped;
+    schedstat_task_t tasks[SCHEDSTAT_MAX_TASKS];
+} schedstat_copy_t;
+
+static void _copy_task(task_t *task, void *arg)
+{
+    schedstat_copy_t *copy = (schedstat_copy_t *)arg;
+    if (copy->count == SCHEDSTAT_MAX_TASKS) {
+        copy->skipped++;
+        return;
+    }
+    schedstat_task_t *entry = &copy->tasks[copy->count++];
+    entry->name = task->name;
+    entry->stats = task->sched_stats.stats;
+}
+
+void schedstat_dump()
+{
+    // take copies so that nothing is printed with interrupts disabled
+    sched_stats_t global;
+    uint32_t depth[SCHEDSTAT_DEPTH_BUCKETS];
+    uint32_t flags = interrupts_save();
+    global = _global;
+    memcpy(depth, _depth, sizeof(depth));
+    interrupts_restore(flags);
+
+    _print_stats("*", &global);
+    // depth <ready tasks>:<count>...
+    rs232::printf("depth *");
+    for (size_t i = 0; i < SCHEDSTAT_DEPTH_BUCKETS; i++) {
+        if (depth[i] != 0) rs232::printf(" %u:%u", i, depth[i]);
+    }
+    rs232::printf("\n");
+    // irqoff <scheduler lock max us> <hardirq max us>
+    irqoff_stats_t irqoff = tasks_irqoff_stats();
+    rs232::printf("irqoff %u %u\n", (uint32_t)(irqoff.sched_lock_max / 1000),
+        (uint32_t)(irqoff.hardirq_max / 1000));
+
+    // a single walk, then print from the copies (only the monitor task
+    // dumps, so the copies don't need to live on its stack)
+    static schedstat_copy_t copy;
+    copy.count = 0;
+    copy.skipped = 0;
+    tasks_for_each(_copy_task, &copy);
+    for (size_t i = 0; i < copy.count; i++) {
+        const char *name = copy.tasks[i].name;
+        _print_stats(name != NULL ? name : "?", &copy.tasks[i].stats);
+    }
+    if (copy.skipped != 0) {
+        rs232::printf("schedstat %u tasks not shown\n", copy.skipped);
+    }
+}
+
+void schedstat_monitor()
+{
+    waitable_t *const input[] = { rs232::rx_waitable() };
+    for (;;) {
+        wait_any(input, 1, TASKS_NO_TIMEOUT);
+        char cmd;
+        while (rs232::read(&cmd, 1) == 1) {
+            if (cmd == 's') {
+                schedstat_dump();
+            } else if (cmd == 'r') {
+                schedstat_reset();
+                rs232::printf("schedstat reset\n");
+            } else if (cmd == 'w') {
+                wss_dump();
+            } else if (cmd == 'i') {
+                idle_dump();
+            } else if (cmd == 'g') {
+                tasks_cpu_group_dump();
+            } else if (cmd == 'l') {
+                irqsoff_dump();
+            } else if (cmd == 'k') {
+                spinlock_dump();
+            } else if (cmd == 't') {
+                top_set_outputs(top_get_outputs() ^ TOP_OUTPUT_SERIAL);
+            }
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * @file schedstat.hpp
+ * @author Panix Contributors
+ * @brief Scheduler latency tracing. Keeps global and per-task histograms
+ * of wakeup-to-run latency and time slice use, counts of voluntary and
+ * involuntary switches, and a histogram of the run queue depth. Samples
+ * are taken from TSC timestamps on every context switch.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// bucket k counts values in [2^k, 2^(k+1)) nanoseconds
+#define SCHEDSTAT_LOG_BUCKETS   32
+// bucket k counts runs that used [10k%, 10(k+1)%) of a time slice,
+// the last one counts runs that used all of it (or more)
+#define SCHEDSTAT_SLICE_BUCKETS 11
+// bucket k counts switches with k other tasks ready, the last one
+// counts SCHEDSTAT_DEPTH_BUCKETS - 1 or more
+#define SCHEDSTAT_DEPTH_BUCKETS 16
+
+typedef struct sched_log_hist
+{
+    uint32_t count;
+    uint32_t max;       // largest sample (nanoseconds)
+    uint32_t buckets[SCHEDSTAT_LOG_BUCKETS];
+} sched_log_hist_t;
+
+typedef struct sched_stats
+{
+    sched_log_hist_t wakeup_latency;
+    uint32_t slice_use[SCHEDSTAT_SLICE_BUCKETS];
+    uint32_t nr_voluntary;      // switched out because it blocked, slept or exited
+    uint32_t nr_involuntary;    // switched out while it could still run
+} sched_stats_t;
+
+/**
+ * @brief Per-task tracing state, embedded in every task_t.
+ *
+ */
+typedef struct sched_task_stats
+{
+    uint64_t wakeup_tsc;    // TSC when the task was woken (0 if not waiting to run)
+    uint64_t run_tsc;       // TSC when the task was last switched in
+    sched_stats_t stats;
+} sched_task_stats_t;
+
+struct task;
+
+/**
+ * @brief Records a task being switched out.
+ *
+ * @param task Task that stops running
+ * @param voluntary The task blocked, slept or exited
+ * @param ran Nanoseconds it ran for since it was switched in
+ */
+void schedstat_switch_out(struct task *task, bool voluntary, uint64_t ran);
+/**
+ * @brief Records a task being switched in.
+ *
+ * @param task Task that starts running
+ * @param latency Nanoseconds since the task was woken, or
+ * UINT64_MAX if it was only preempted rather than woken
+ * @param depth Number of other tasks ready to run
+ */
+void schedstat_switch_in(struct task *task, uint64_t latency, size_t depth);
+/**
+ * @brief Prints the global and per-task statistics over serial,
+ * one compact line per histogram, along with the longest spans that
+ * interrupts were disabled for (see tasks_irqoff_stats()). Tasks past
+ * the first 32 are only counted.
+ *
+ */
+void schedstat_dump();
+/**
+ * @brief Clears the global and per-task statistics.
+ *
+ */
+void schedstat_reset();
+/**
+ * @brief Task that dumps the statistics when 's' is received over
+ * serial and resets them when 'r' is received. 'w' dumps the working
+ * set estimates, 'i' the idle state residency, 'g' the CPU bandwidth
+ * groups, 'l' the worst interrupts-off spans and 'k' the spinlock
+ * contention counters. 't' turns streaming of the top monitor's samples
+ * on or off.
+ *
+ */
+void schedstat_monitor();
@@ -0,0 +1,159 @@
+/**
+ * @file softirq.cpp
+ * @author Panix Contributors
+ * @brief Software interrupts (bottom halves) and tasklets
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/softirq.hpp>
+#include <sys/tasks.hpp>
+#include <sys/workqueue.hpp>
+#include <arch/arch.hpp>
+#include <x86gprintrin.h>   // needed for __rdtsc
+
+// bound the work done on a single interrupt exit so that a flood
+// of raised softirqs can't starve the interrupted task forever
+#define SOFTIRQ_MAX_RESTART 8
+
+static void _run_tasklets();
+static void _run_deferred(void *data);
+
+static softirq_handler_t _handlers[SOFTIRQ_COUNT] = {
+    [SOFTIRQ_TASKLET] = _run_tasklets,
+};
+
+// picks up whatever is left pending once the restart bound is hit, from a
+// [kworker] task that can be preempted like any other
+static work_t _deferred = {
+    .next = NULL,
+    .func = _run_deferred,
+    .data = NULL,
+    .pending = 0,
+};
+
+void softirq_register(softirq_nr nr, softirq_handler_t handler)
+{
+    _handlers[nr] = handler;
+}
+
+void softirq_raise(softirq_nr nr)
+{
+    uint32_t flags = interrupts_save();
+    this_cpu_write(softirq_pending, this_cpu_read(softirq_pending) | (1U << nr));
+    interrupts_restore(flags);
+}
+
+void softirq_run()
+{
+    // softirqs never nest, the outer invocation will pick up anything new
+    if (this_cpu_read(softirq_active) || this_cpu_read(softirq_pending) == 0) {
+        return;
+    }
+    this_cpu_write(softirq_active, 1);
+    // tasks woken by the handlers are switched to once we are done
+    preempt_disable();
+    size_t restart = 0;
+    uint32_t pending;
+    while ((pending = this_cpu_read(softirq_pending)) != 0 && restart++ < SOFTIRQ_MAX_RESTART) {
+        this_cpu_write(softirq_pending, 0);
+        interrupts_on();
+        for (size_t nr = 0; nr < SOFTIRQ_COUNT; nr++) {
+            if ((pending & (1U << nr)) && _handlers[nr] != NULL) {
+                _handlers[nr]();
+            }
+        }
+        interrupts_off();
+    }
+    if (pending != 0) {
+        // still flooded, don't leave the rest until the next interrupt
+        schedule_work(&_deferred);
+    }
+    this_cpu_write(softirq_active, 0);
+    preempt_enable();
+    // the scheduler lock may have re-enabled interrupts on release
+    interrupts_off();
+}
+
+static void _run_deferred(void *)
+{
+    interrupts_off();
+    softirq_run();
+    interrupts_on();
+}
+
+void irq_enter()
+{
+    if ((this_cpu_read(preempt_count) & ~PREEMPT_MASK) == 0) {
+        this_cpu()->hardirq_tsc = __rdtsc();
+        fpu_irq_enter();
+    }
+    this_cpu_add(preempt_count, PREEMPT_HARDIRQ_OFFSET);
+}
+
+void irq_exit()
+{
+    cpu_local_t *cpu = this_cpu();
+    if ((this_cpu_read(preempt_count) & ~PREEMPT_MASK) == PREEMPT_HARDIRQ_OFFSET) {
+        uint64_t handled = __rdtsc() - cpu->hardirq_tsc;
+        if (handled > cpu->hardirq_max) cpu->hardirq_max = handled;
+    }
+    softirq_run();
+    if ((this_cpu_read(preempt_count) & ~PREEMPT_MASK) == PREEMPT_HARDIRQ_OFFSET) {
+        fpu_irq_exit();
+    }
+    // this is where the interrupted task is preempted if the interrupt
+    // woke a more important one, unless it had preemption disabled
+    preempt_count_sub(PREEMPT_HARDIRQ_OFFSET);
+    // the scheduler lock may have re-enabled interrupts on release
+    interrupts_off();
+}
+
+void tasklet_init(tasklet_t *tasklet, void (*func)(void *), void *data)
+{
+    *tasklet = {
+        .next = NULL,
+        .func = func,
+        .data = data,
+        .scheduled = 0,
+    };
+}
+
+void tasklet_schedule(tasklet_t *tasklet)
+{
+    uint32_t flags = interrupts_save();
+    if (!tasklet->scheduled) {
+        tasklet->scheduled = 1;
+        tasklet->next = NULL;
+        cpu_local_t *cpu = this_cpu();
+        if (cpu->tasklet_tail != NULL) {
+            cpu->tasklet_tail->next = tasklet;
+        } else {
+            cpu->tasklet_head = tasklet;
+        }
+        cpu->tasklet_tail = tasklet;
+        softirq_raise(SOFTIRQ_TASKLET);
+    }
+    interrupts_restore(flags);
+}
+
+static void _run_tasklets()
+{
+    cpu_local_t *cpu = this_cpu();
+    // take the whole list at once, tasklets scheduled while
+    // these run will be picked up by the next softirq pass
+    interrupts_off();
+    tasklet_t *tasklet = cpu->tasklet_head;
+    cpu->tasklet_head = NULL;
+    cpu->tasklet_tail = NULL;
+    interrupts_on();
+    while (tasklet != NULL) {
+        tasklet_t *next = tasklet->next;
+        // clear first so the tasklet may reschedule itself
+        tasklet->scheduled = 0;
+        tasklet->func(tasklet->data);
+        tasklet = next;
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file softirq.hpp
+ * @author Panix Contributors
+ * @brief Software interrupts (bottom halves) and tasklets. IRQ handlers
+ * raise a softirq or schedule a tasklet instead of doing slow work in
+ * interrupt context, and the deferred work is then run with interrupts
+ * enabled on the way out of the interrupt.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum softirq_nr
+{
+    SOFTIRQ_TASKLET = 0,
+    SOFTIRQ_HRTIMER,
+    SOFTIRQ_RCU,
+    SOFTIRQ_COUNT
+};
+
+typedef void (*softirq_handler_t)(void);
+
+typedef struct tasklet tasklet_t;
+struct tasklet
+{
+    tasklet_t *next;
+    void (*func)(void *);
+    void *data;
+    uint32_t scheduled;
+};
+
+/**
+ * @brief Registers the handler run whenever the given softirq is raised.
+ *
+ * @param nr Softirq number
+ * @param handler Handler function
+ */
+void softirq_register(softirq_nr nr, softirq_handler_t handler);
+/**
+ * @brief Marks a softirq as pending on this CPU. Safe to call from
+ * interrupt context.
+ *
+ * @param nr Softirq number
+ */
+void softirq_raise(softirq_nr nr);
+/**
+ * @brief Runs all pending softirqs with interrupts enabled. Called on the
+ * way out of every IRQ with interrupts disabled, and returns with them
+ * disabled again. Does nothing if it interrupted softirq processing.
+ * Softirqs that keep getting raised are left to the system work queue
+ * after a few rounds, so the interrupted task gets to run meanwhile.
+ *
+ */
+void softirq_run();
+/**
+ * @brief Marks the start of a hardware interrupt. Preemption is disabled
+ * until the matching irq_exit(), so tasks woken by the handler are only
+ * switched to once it is done.
+ *
+ */
+void irq_enter();
+/**
+ * @brief Marks the end of a hardware interrupt. Runs pending softirqs and
+ * then preempts the interrupted task if a more important one was woken
+ * and the task didn't have preemption disabled. Returns with interrupts
+ * disabled.
+ *
+ */
+void irq_exit();
+/**
+ * @brief Initializes a tasklet.
+ *
+ * @param tasklet Tasklet to initialize
+ * @param func Function to run
+ * @param data Argument passed to the function
+ */
+void tasklet_init(tasklet_t *tasklet, void (*func)(void *), void *data);
+/**
+ * @brief Schedules a tasklet to be run from softirq context. A tasklet
+ * that is scheduled again before it runs will only run once.
+ *
+ * @param tasklet Tasklet to schedule
+ */
+void tasklet_schedule(tasklet_t *tasklet);
@@ -11,7 +11,10 @@
 #include <sys/tasks.hpp>
 #include <mem/heap.hpp>
 #include <sys/panic.hpp>
+#include <sys/rcu.hpp>
+#include <sys/hrtimer.hpp>
 #include <lib/stdio.hpp>
+#include <lib/errno.h>
 #include <dev/serial/rs232.hpp>
 #include <stdint.h>         // Data type definitions
 #include <x86gprintrin.h>   // needed for __rdtsc
@@ -24,6 +27,8 @@ static task_t *_dequeue_task(tasklist_t *);
 static void _cleaner_task_impl(void);
 static void _schedule(void);
 extern "C" void _tasks_enqueue_ready(task_t *task);
+static tasklist_t *_ready_list(const task_t *task);
+static inline uint64_t _get_cpu_time_ns();
 void tasks_update_time();
 void _wakeup(task_t *task);
 
@@ -35,24 +40,34 @@ void _wakeup(task_t *task);
     static inline task_t *_dequeue_##name() { \
         return _dequeue_task(&tasks_##name); }
 
-task_t *current_task = NULL;
 static task_t _cleaner_task;
 static task_t _first_task;
 
-tasklist_t tasks_ready = { /* Zero */ };
-NAMED_TASKLIST(sleeping);
+// one ready queue per priority level, with a bit set in
+// the mask for every level that has tasks queued
+static tasklist_t tasks_ready[TASK_PRIO_LEVELS];
+static uint32_t _ready_mask = 0;
+// deadline class tasks that are ready, earliest deadline first
+static tasklist_t tasks_deadline = { /* Zero */ };
+// sum of the bandwidths of all deadline class tasks
+static uint32_t _dl_total_bw = 0;
+// number of tasks in all ready queues
+static size_t _nr_ready = 0;
+// every task that exists, linked through all_next
+static task_t *_all_tasks = NULL;
+// exited tasks kept with their stack page and FPU area for the next
+// spawn, linked through next (stack_top holds the base of the stack)
+static task_t *_task_pool = NULL;
+static task_pool_stats_t _pool_stats = { };
+// every bandwidth group, linked through all_next
+static cpu_group_t *_all_cpu_groups = NULL;
+NAMED_TASKLIST(idle);
+// sleeping tasks, soonest wakeup first so that the timer
+// only has to look at the ones that are due
+tasklist_t tasks_sleeping = { /* Zero */ };
+static inline task_t *_dequeue_sleeping() { return _dequeue_task(&tasks_sleeping); }
 NAMED_TASKLIST(stopped);
 
-// map between task state and the list it is in
-static tasklist_t *_state_lists[TASK_STATE_COUNT] = {
-    [TASK_RUNNING] = NULL, // not in a list
-    [TASK_READY] = &tasks_ready,
-    [TASK_SLEEPING] = &tasks_sleeping,
-    [TASK_BLOCKED] = NULL, // in a list specific to the blocking primitive
-    [TASK_STOPPED] = &tasks_stopped,
-    [TASK_PAUSED] = NULL, // not in a list
-};
-
 // map between task state and its name
 static const char *_state_names[TASK_STATE_COUNT] = {
     [TASK_RUNNING] = "RUNNING",
@@ -63,36 +78,55 @@ static const char *_state_names[TASK_STATE_COUNT] = {
     [TASK_PAUSED] = "PAUSED",
 };
 
-static uint64_t _idle_time = 0;
-static uint64_t _idle_start = 0;
-static uint64_t _last_time = 0;
-static uint64_t _time_slice_remaining = 0;
-static uint64_t _last_timer_time = 0;
-static size_t _scheduler_lock = 0;
-static size_t _scheduler_postpone_count = 0;
-static bool _scheduler_postponed = false;
+// all other scheduler state is kept per-CPU (see cpu_local_t)
 static uint64_t _instr_per_ns;
 
+// The scheduler lock disables interrupts on this CPU and counts as a
+// preempt_disable(). With a single CPU that is all a per-CPU spinlock
+// taken with interrupts disabled would do, so there is no lock word.
+// Its hold time bounds interrupt latency (see tasks_irqoff_stats()), so
+// keep what is done under it short and bounded.
 static void _aquire_scheduler_lock()
 {
-    asm volatile("cli");
-    _scheduler_postpone_count++;
-    _scheduler_lock++;
+    interrupts_off();
+    if (this_cpu_read(sched_lock) == 0) {
+        this_cpu()->sched_lock_tsc = __rdtsc();
+    }
+#ifdef IRQSOFF_TRACE
+    if (this_cpu_read(preempt_count) == 0) {
+        preemptoff_start(IRQSOFF_THIS_IP);
+    }
+#endif
+    this_cpu_inc(preempt_count);
+    this_cpu_inc(sched_lock);
+}
+
+static void _sched_lock_account(cpu_local_t *cpu)
+{
+    uint64_t held = __rdtsc() - cpu->sched_lock_tsc;
+    if (held > cpu->sched_lock_max) cpu->sched_lock_max = held;
+}
+
+static void _sched_unlock_irq()
+{
+    this_cpu_dec(sched_lock);
+    if (this_cpu_read(sched_lock) == 0) {
+        _sched_lock_account(this_cpu());
+        interrupts_on();
+    }
 }
 
 static void _release_scheduler_lock()
 {
-    _scheduler_postpone_count--;
-    if (_scheduler_postpone_count == 0) {
-        if (_scheduler_postponed) {
-            _scheduler_postponed = false;
+    this_cpu_dec(preempt_count);
+    if (this_cpu_read(preempt_count) == 0) {
+        preemptoff_stop(IRQSOFF_THIS_IP);
+        if (this_cpu_read(sched_postponed)) {
+            this_cpu_write(sched_postponed, 0);
             _schedule();
         }
     }
-    _scheduler_lock--;
-    if (_scheduler_lock == 0) {
-        asm volatile("sti");
-    }
+    _sched_unlock_irq();
 }
 
 static void _discover_cpu_speed()
@@ -111,6 +145,11 @@ static inline uint64_t _get_cpu_time_ns()
     return (__rdtsc()) / _instr_per_ns;
 }
 
+static inline uint64_t _tsc_to_ns(uint64_t tsc)
+{
+    return tsc / _instr_per_ns;
+}
+
 static void _print_task(const task_t *task)
 {
     rs232::printf("%s is %s\n", task->name, _state_names[task->state]);
@@ -122,29 +161,27 @@ static void _print_task(const task_t *task)
 #define TASK_ACTION(action, task)
 #endif
 
-static void _print_tasklist(const char *name, const tasklist_t *list)
+static void _print_in_state(task_t *task, void *arg)
 {
-    task_t *task = list->head;
-    rs232::printf("%s:\n", name);
-    while (task != NULL) {
+    if (task->state == *(const task_state *)arg) {
         _print_task(task);
-        task = task->next;
     }
 }
 
+// prints every task sharing the given task's state. The list of all tasks
+// is walked as an RCU reader, so the dump never holds the scheduler lock
+// (or any other exclusive lock) and doesn't hold up wakeups meanwhile.
 static void _print_tasklist(const task_t *task)
 {
-    const tasklist_t *list = _state_lists[task->state];
-    const char *state_name = _state_names[task->state];
-    if (list == NULL) {
-        rs232::printf("no tasklist available for %s tasks.\n", state_name);
-        return;
-    }
-
-    _print_tasklist(state_name, list);
+    task_state state = task->state;
+    rs232::printf("%s:\n", _state_names[state]);
+    tasks_for_each(_print_in_state, &state);
 }
 
-static void _on_timer();
+static void _on_timer(hrtimer_t *timer);
+static void _sync_timeout(hrtimer_t *timer);
+// drives _on_timer() once every timer tick
+static hrtimer_t _sched_timer;
 
 void tasks_init()
 {
@@ -169,19 +206,51 @@ void tasks_init()
         .name = "[main]",
         // this is not backed by dynamic memory
         .alloc = ALLOC_STATIC,
+        // the kernel task competes like any other foreground task
+        .sched_class = SCHED_NORMAL,
+        // not waiting on anything
+        .sync_handoff = false,
+        // and just as important as everything else
+        .priority = TASK_PRIO_DEFAULT,
+        .base_priority = TASK_PRIO_DEFAULT,
+        .blocked_on = NULL,
+        .boosters = NULL,
+        // the list of all tasks starts with this one
+        .all_next = NULL,
+        .sched_stats = { },
+        // set up by fpu_task_init()
+        .fpu_state = NULL,
+        .fpu_alloc = NULL,
+        // not a deadline task
+        .dl = { },
+        // set up below
+        .timeout = { },
+        .timed_out = false,
+        // not limited by any group
+        .group = NULL,
     };
+    _all_tasks = this_task;
+    hrtimer_init(&this_task->timeout, _sync_timeout, this_task, HRTIMER_MODE_HARD);
+    fpu_task_init(this_task);
+    this_task->sched_stats.run_tsc = __rdtsc();
     TASK_ACTION("create task", this_task);
     // create a task for the cleaner and set it's state to "paused"
     (void) tasks_new(_cleaner_task_impl, &_cleaner_task, TASK_PAUSED, "[cleaner]");
     _cleaner_task.state = TASK_PAUSED;
+    // cleaning up can always wait until there is nothing better to do
+    _cleaner_task.sched_class = SCHED_IDLE;
+    // have some tasks ready to go for the spawn fast path
+    tasks_pool_reserve(TASK_POOL_PREFILL);
     // update the timer variables
-    _last_time = _get_cpu_time_ns();
-    _last_timer_time = _last_time;
+    cpu_local_t *cpu = this_cpu();
+    cpu->last_time = _get_cpu_time_ns();
+    cpu->last_timer_time = cpu->last_time;
     // enable time slices
-    _time_slice_remaining = TIME_SLICE_SIZE;
+    cpu->time_slice_remaining = TIME_SLICE_SIZE;
     // this is the current task
-    current_task = this_task;
-    timer_register_callback(_on_timer);
+    this_cpu_write(current_task, this_task);
+    hrtimer_init(&_sched_timer, _on_timer, NULL, HRTIMER_MODE_HARD);
+    hrtimer_start(&_sched_timer, cpu->last_time + timer_period_ns(), timer_period_ns());
 }
 
 static void _task_starting()
@@ -191,10 +260,7 @@ static void _task_starting()
 
     // the task before this caused the scheduler to lock
     // so we must unlock here
-    _scheduler_lock--;
-    if (_scheduler_lock == 0) {
-        asm volatile("sti");
-    }
+    _sched_unlock_irq();
 }
 
 static void _task_stopping()
@@ -274,34 +340,449 @@ static void _remove_task(tasklist_t *list, task_t *task, task_t *previous)
     task->next = NULL;
 }
 
+static void _enqueue_deadline(task_t *task)
+{
+    // keep the queue sorted by deadline, FIFO among equal deadlines
+    task_t *pre = NULL;
+    task_t *iter = tasks_deadline.head;
+    while (iter != NULL && iter->dl.abs_deadline <= task->dl.abs_deadline) {
+        pre = iter;
+        iter = iter->next;
+    }
+    task->next = iter;
+    if (pre == NULL) {
+        tasks_deadline.head = task;
+    } else {
+        pre->next = task;
+    }
+    if (iter == NULL) {
+        tasks_deadline.tail = task;
+    }
+}
+
+static void _enqueue_sleeping(task_t *task)
+{
+    // keep the list sorted by wakeup time, FIFO among equal times
+    task_t *pre = NULL;
+    task_t *iter = tasks_sleeping.head;
+    while (iter != NULL && iter->wakeup_time <= task->wakeup_time) {
+        pre = iter;
+        iter = iter->next;
+    }
+    task->next = iter;
+    if (pre == NULL) {
+        tasks_sleeping.head = task;
+    } else {
+        pre->next = task;
+    }
+    if (iter == NULL) {
+        tasks_sleeping.tail = task;
+    }
+}
+
+static void _dl_refresh(task_t *task, uint64_t now)
+{
+    task_dl_t *dl = &task->dl;
+    if (now < dl->period_end) {
+        // still in the same period, with whatever budget is left
+        return;
+    }
+    // start the period that now falls in, skipping any that passed entirely
+    dl->period_end += dl->period * ((now - dl->period_end) / dl->period + 1);
+    dl->abs_deadline = dl->period_end - dl->period + dl->deadline;
+    dl->remaining = (int64_t)dl->runtime;
+    dl->throttled = false;
+}
+
+static void _dl_charge(task_t *task, uint64_t now)
+{
+    task->dl.remaining -= (int64_t)(now - task->dl.exec_start);
+    task->dl.exec_start = now;
+}
+
+static void _dl_throttle(task_t *task)
+{
+    // out of budget, so it sleeps until its next period replenishes it
+    if (!task->dl.throttled) {
+        task->dl.throttled = true;
+        task->dl.nr_throttled++;
+    }
+    task->state = TASK_SLEEPING;
+    task->wakeup_time = task->dl.period_end;
+    _enqueue_sleeping(task);
+}
+
+static void _group_refresh(cpu_group_t *group, uint64_t now)
+{
+    if (group->quota == 0 || now < group->period_end) {
+        return;
+    }
+    // start the period that now falls in, skipping any that passed entirely
+    uint64_t periods = (now - group->period_end) / group->period + 1;
+    group->period_end += group->period * periods;
+    group->nr_periods += (uint32_t)periods;
+    // an overrun of the last period is paid back out of this one
+    group->remaining = (int64_t)group->quota + (group->remaining < 0 ? group->remaining : 0);
+    if (group->throttled) {
+        group->throttled = false;
+        group->throttled_time += now - group->throttled_since;
+    }
+}
+
+static void _group_charge(cpu_group_t *group, uint64_t delta)
+{
+    for (; group != NULL; group = group->parent) {
+        group->usage += delta;
+        if (group->quota != 0) {
+            group->remaining -= (int64_t)delta;
+        }
+    }
+}
+
+static cpu_group_t *_group_exhausted(task_t *task, uint64_t now)
+{
+    // deadline tasks only answer to their own budget
+    if (task->sched_class == SCHED_DEADLINE) {
+        return NULL;
+    }
+    for (cpu_group_t *group = task->group; group != NULL; group = group->parent) {
+        if (group->quota == 0) continue;
+        _group_refresh(group, now);
+        if (group->remaining <= 0) {
+            if (!group->throttled) {
+                group->throttled = true;
+                group->throttled_since = now;
+                group->nr_throttled++;
+            }
+            return group;
+        }
+    }
+    return NULL;
+}
+
+static void _group_throttle(task_t *task, const cpu_group_t *group)
+{
+    // parked with the sleeping tasks until the group's next period
+    task->state = TASK_SLEEPING;
+    task->wakeup_time = group->period_end;
+    _enqueue_sleeping(task);
+}
+
 extern "C" void _tasks_enqueue_ready(task_t *task)
 {
-    _enqueue_task(&tasks_ready, task);
+    if (task->group != NULL) {
+        cpu_group_t *group = _group_exhausted(task, _get_cpu_time_ns());
+        if (group != NULL) {
+            _group_throttle(task, group);
+            return;
+        }
+    }
+    if (task->sched_class == SCHED_DEADLINE) {
+        _dl_refresh(task, _get_cpu_time_ns());
+        if (task->dl.remaining <= 0) {
+            _dl_throttle(task);
+            return;
+        }
+        _enqueue_deadline(task);
+    } else if (task->sched_class == SCHED_IDLE) {
+        _enqueue_idle(task);
+    } else {
+        _enqueue_task(&tasks_ready[task->priority], task);
+        _ready_mask |= 1U << task->priority;
+    }
+    _nr_ready++;
+    idle_kick();
+}
+
+static inline uint32_t _ready_top()
+{
+    // the most urgent priority level with queued tasks (mask must be non-zero)
+    return 31 - __builtin_clz(_ready_mask);
 }
 
 static task_t *_tasks_dequeue_ready()
 {
-    return _dequeue_task(&tasks_ready);
+    task_t *current = this_cpu_read(current_task);
+    bool running = current != NULL && current->state == TASK_RUNNING;
+    // deadline tasks run first, and only an earlier deadline preempts one
+    if (tasks_deadline.head != NULL) {
+        if (running && current->sched_class == SCHED_DEADLINE &&
+            current->dl.abs_deadline <= tasks_deadline.head->dl.abs_deadline) {
+            return NULL;
+        }
+        _nr_ready--;
+        return _dequeue_task(&tasks_deadline);
+    }
+    if (running && current->sched_class == SCHED_DEADLINE) {
+        return NULL;
+    }
+    // a normal task that is still running keeps the CPU unless a task at
+    // least as urgent is waiting (round robin within a priority level)
+    running = running && current->sched_class == SCHED_NORMAL;
+    // normal tasks always take precedence over the idle class
+    if (_ready_mask != 0) {
+        uint32_t top = _ready_top();
+        if (running && top < current->priority) {
+            return NULL;
+        }
+        task_t *task = _dequeue_task(&tasks_ready[top]);
+        if (tasks_ready[top].head == NULL) {
+            _ready_mask &= ~(1U << top);
+        }
+        _nr_ready--;
+        return task;
+    }
+    // nor does a running normal task give up the CPU to background work
+    if (running) {
+        return NULL;
+    }
+    task_t *task = _dequeue_idle();
+    if (task != NULL) {
+        _nr_ready--;
+    }
+    return task;
 }
 
-task_t *tasks_new(void (*entry)(void), task_t *storage, task_state state, const char *name)
+static task_t *_pick_next()
+{
+    // tasks whose group ran out of quota while they were queued
+    // wait for its next period instead of running
+    task_t *task;
+    while ((task = _tasks_dequeue_ready()) != NULL && task->group != NULL) {
+        cpu_group_t *group = _group_exhausted(task, _get_cpu_time_ns());
+        if (group == NULL) break;
+        _group_throttle(task, group);
+    }
+    return task;
+}
+
+static tasklist_t *_ready_list(const task_t *task)
+{
+    switch (task->sched_class) {
+        case SCHED_DEADLINE: return &tasks_deadline;
+        case SCHED_IDLE: return &tasks_idle;
+        default: return &tasks_ready[task->priority];
+    }
+}
+
+static void _remove_ready(task_t *task)
+{
+    // find the task in its ready queue so it can be taken out
+    tasklist_t *list = _ready_list(task);
+    task_t *pre = NULL;
+    task_t *iter = list->head;
+    while (iter != NULL && iter != task) {
+        pre = iter;
+        iter = iter->next;
+    }
+    if (iter == NULL) {
+        PANIC("Ready task is missing from its ready queue.\n");
+    }
+    _remove_task(list, task, pre);
+    if (task->sched_class == SCHED_NORMAL && list->head == NULL) {
+        _ready_mask &= ~(1U << task->priority);
+    }
+    _nr_ready--;
+}
+
+static void _check_preempt(const task_t *task)
+{
+    // a task of a more important class or priority preempts the current
+    // one right away (this only flags the scheduler while the lock is held)
+    task_t *current = this_cpu_read(current_task);
+    if (current == NULL || task->state != TASK_READY) {
+        // (a deadline task may have been throttled instead of queued)
+        return;
+    }
+    if (task->sched_class < current->sched_class ||
+        (task->sched_class == SCHED_DEADLINE && current->sched_class == SCHED_DEADLINE &&
+         task->dl.abs_deadline < current->dl.abs_deadline) ||
+        (task->sched_class == SCHED_NORMAL && current->sched_class == SCHED_NORMAL &&
+         task->priority > current->priority)) {
+        _schedule();
+    }
+}
+
+static void _change_priority(task_t *task, uint32_t priority)
+{
+    if (task->priority == priority) {
+        return;
+    }
+    if (task->state == TASK_READY) {
+        // move it over to the queue for its new priority
+        _remove_ready(task);
+        task->priority = priority;
+        _tasks_enqueue_ready(task);
+        _check_preempt(task);
+    } else {
+        task->priority = priority;
+        // the current task may no longer be the most urgent one
+        if (task == this_cpu_read(current_task) && _ready_mask != 0 &&
+            task->sched_class == SCHED_NORMAL && _ready_top() > priority) {
+            _schedule();
+        }
+    }
+}
+
+// bounds how far a chain of blocked lock holders is followed
+#define TASK_INHERIT_DEPTH 8
+
+static inline uint32_t _sync_priority(const task_t *task)
+{
+    // deadline tasks outrank every normal task, and so do their lock holders
+    return task->sched_class == SCHED_DEADLINE ? TASK_PRIO_MAX : task->priority;
+}
+
+static void _inherit_priority(tasks_sync_t *ts, uint32_t priority)
+{
+    // boost the possessor, and whoever it is waiting for in turn
+    for (size_t depth = 0; depth < TASK_INHERIT_DEPTH; depth++) {
+        if (ts == NULL || !ts->inherit) break;
+        task_t *owner = ts->possessor;
+        if (owner == NULL || owner->priority >= priority) break;
+        _change_priority(owner, priority);
+        ts = owner->state == TASK_BLOCKED ? owner->blocked_on : NULL;
+    }
+}
+
+static task_t *_dequeue_waiter(tasks_sync_t *ts)
+{
+    // the most urgent waiter goes first, the longest waiting among equals
+    task_t *best = ts->waiting.head;
+    task_t *best_pre = NULL;
+    task_t *pre = best;
+    if (best == NULL) {
+        return NULL;
+    }
+    for (task_t *iter = best->next; iter != NULL; pre = iter, iter = iter->next) {
+        if (_sync_priority(iter) > _sync_priority(best)) {
+            best = iter;
+            best_pre = pre;
+        }
+    }
+    _remove_task(&ts->waiting, best, best_pre);
+    best->blocked_on = NULL;
+    return best;
+}
+
+static uint32_t _waiters_priority(const tasks_sync_t *ts)
+{
+    uint32_t priority = TASK_PRIO_MIN;
+    for (const task_t *iter = ts->waiting.head; iter != NULL; iter = iter->next) {
+        if (_sync_priority(iter) > priority) priority = _sync_priority(iter);
+    }
+    return priority;
+}
+
+// keeps an inherit queue on its possessor's boosters list for as long
+// as it has waiters, must be called whenever either changes
+static void _boost_update(tasks_sync_t *ts)
+{
+    task_t *owner = ts->inherit && ts->waiting.head != NULL ? ts->possessor : NULL;
+    if (ts->boosts == owner) {
+        return;
+    }
+    if (ts->boosts != NULL) {
+        tasks_sync_t **link = &ts->boosts->boosters;
+        while (*link != ts) {
+            link = &(*link)->booster_next;
+        }
+        *link = ts->booster_next;
+    }
+    ts->boosts = owner;
+    if (owner != NULL) {
+        ts->booster_next = owner->boosters;
+        owner->boosters = ts;
+    }
+}
+
+// the priority a task is owed: its own, or that of the most urgent
+// waiter on any inherit queue it still possesses
+static uint32_t _owed_priority(const task_t *task)
+{
+    uint32_t priority = task->base_priority;
+    for (const tasks_sync_t *ts = task->boosters; ts != NULL; ts = ts->booster_next) {
+        uint32_t waiters = _waiters_priority(ts);
+        if (waiters > priority) priority = waiters;
+    }
+    return priority;
+}
+
+// drops a boost that is no longer owed, and passes that on to whoever
+// the task is blocked behind
+static void _unboost(task_t *task)
+{
+    for (size_t depth = 0; depth < TASK_INHERIT_DEPTH && task != NULL; depth++) {
+        uint32_t priority = _owed_priority(task);
+        if (priority >= task->priority) break;
+        _change_priority(task, priority);
+        tasks_sync_t *ts = task->state == TASK_BLOCKED ? task->blocked_on : NULL;
+        task = ts != NULL && ts->inherit ? ts->possessor : NULL;
+    }
+}
+
+static task_t *_pool_get()
+{
+    _aquire_scheduler_lock();
+    task_t *task = _task_pool;
+    if (task != NULL) {
+        _task_pool = task->next;
+        _pool_stats.cached--;
+        _pool_stats.hits++;
+    } else {
+        _pool_stats.misses++;
+    }
+    _release_scheduler_lock();
+    return task;
+}
+
+static bool _pool_put(task_t *task, bool recycled)
+{
+    bool kept = false;
+    _aquire_scheduler_lock();
+    if (_pool_stats.cached < TASK_POOL_SIZE) {
+        task->stack_top &= PAGE_ALIGN;
+        task->next = _task_pool;
+        _task_pool = task;
+        _pool_stats.cached++;
+        if (recycled) _pool_stats.recycled++;
+        kept = true;
+    }
+    _release_scheduler_lock();
+    return kept;
+}
+
+static task_t *_tasks_new(uintptr_t entry, void *arg, task_t *storage, task_state state, const char *name)
 {
     task_t *new_task = storage;
+    uint8_t *stack = NULL;
     if (storage == NULL) {
-        // allocate memory for our task structure
-        new_task = (task_t*)malloc(sizeof(task_t));
-        // panic if the alloc fails (we have no fallback)
-        if (new_task == NULL) {
-            PANIC("Unable to allocate memory for new task struct.\n");
+        // the fast path reuses a task that exited along with its stack
+        new_task = _pool_get();
+        if (new_task != NULL) {
+            stack = (uint8_t *)new_task->stack_top;
+            fpu_task_reset(new_task);
+        } else {
+            // allocate memory for our task structure
+            new_task = (task_t*)malloc(sizeof(task_t));
+            // panic if the alloc fails (we have no fallback)
+            if (new_task == NULL) {
+                PANIC("Unable to allocate memory for new task struct.\n");
+            }
         }
     }
-    // allocate a page for this stack (we might change this later)
-    uint8_t *stack = (uint8_t *)get_new_page(PAGE_SIZE - 1);
-    if (stack == NULL) PANIC("Unable to allocate memory for new task stack.\n");
+    if (stack == NULL) {
+        // allocate a page for this stack (we might change this later)
+        stack = (uint8_t *)get_new_page(PAGE_SIZE - 1);
+        if (stack == NULL) PANIC("Unable to allocate memory for new task stack.\n");
+        fpu_task_init(new_task);
+    }
     // remember, the stack grows up
     void *stack_pointer = stack + PAGE_SIZE;
     // a null stack frame to make the panic screen happy
     _stack_push_word(&stack_pointer, 0);
+    // the entry point finds this as its first (cdecl) argument
+    _stack_push_word(&stack_pointer, (size_t)arg);
     // the last thing to happen is the task stopping function
     _stack_push_word(&stack_pointer, (size_t)_task_stopping);
     // next entry is the main function to call (the start of the task)
@@ -321,87 +802,467 @@ task_t *tasks_new(void (*entry)(void), task_t *storage, task_state state, const
     new_task->time_used = 0;
     new_task->name = name;
     new_task->alloc = storage == NULL ? ALLOC_DYNAMIC : ALLOC_STATIC;
+    new_task->sched_class = SCHED_NORMAL;
+    new_task->sync_handoff = false;
+    new_task->priority = TASK_PRIO_DEFAULT;
+    new_task->base_priority = TASK_PRIO_DEFAULT;
+    new_task->blocked_on = NULL;
+    new_task->boosters = NULL;
+    new_task->sched_stats = { };
+    new_task->dl = { };
+    hrtimer_init(&new_task->timeout, _sync_timeout, new_task, HRTIMER_MODE_HARD);
+    new_task->timed_out = false;
+    _aquire_scheduler_lock();
+    // new tasks start out in their creator's group
+    task_t *creator = this_cpu_read(current_task);
+    new_task->group = creator != NULL ? creator->group : NULL;
+    if (new_task->group != NULL) {
+        new_task->group->nr_tasks++;
+    }
+    // publish the task only once it is fully set up, since
+    // tasks_for_each() walks this list without the scheduler lock
+    new_task->all_next = _all_tasks;
+    rcu_assign_pointer(_all_tasks, new_task);
     if (state == TASK_READY) {
+        new_task->sched_stats.wakeup_tsc = __rdtsc();
         _tasks_enqueue_ready(new_task);
+        _check_preempt(new_task);
     }
+    _release_scheduler_lock();
     TASK_ACTION("create task", new_task);
     return new_task;
 }
 
+void tasks_pool_reserve(size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        task_t *task = (task_t *)malloc(sizeof(task_t));
+        void *stack = get_new_page(PAGE_SIZE - 1);
+        if (task == NULL || stack == NULL) {
+            PANIC("Unable to allocate memory for the task pool.\n");
+        }
+        task->stack_top = (uintptr_t)stack;
+        fpu_task_init(task);
+        if (!_pool_put(task, false)) {
+            // the pool is already full
+            fpu_task_free(task);
+            free_page(stack, PAGE_SIZE - 1);
+            free(task);
+            break;
+        }
+    }
+}
+
+task_pool_stats_t tasks_pool_stats()
+{
+    _aquire_scheduler_lock();
+    task_pool_stats_t stats = _pool_stats;
+    _release_scheduler_lock();
+    return stats;
+}
+
+task_t *tasks_new(void (*entry)(void), task_t *storage, task_state state, const char *name)
+{
+    return _tasks_new((uintptr_t)entry, NULL, storage, state, name);
+}
+
+task_t *tasks_new_arg(void (*entry)(void *), void *arg, task_t *storage, task_state state, const char *name)
+{
+    return _tasks_new((uintptr_t)entry, arg, storage, state, name);
+}
+
+static void _stat_switch_out(task_t *task)
+{
+    // a task that is still runnable (or ran out of budget) was preempted
+    uint64_t ran = _tsc_to_ns(__rdtsc() - task->sched_stats.run_tsc);
+    schedstat_switch_out(task, task->state != TASK_RUNNING && !task->dl.throttled, ran);
+}
+
+static void _stat_switch_in(task_t *task)
+{
+    uint64_t now = __rdtsc();
+    uint64_t latency = UINT64_MAX;
+    if (task->sched_stats.wakeup_tsc != 0) {
+        latency = _tsc_to_ns(now - task->sched_stats.wakeup_tsc);
+        task->sched_stats.wakeup_tsc = 0;
+    }
+    task->sched_stats.run_tsc = now;
+    schedstat_switch_in(task, latency, _nr_ready);
+}
+
 void tasks_update_time()
 {
+    cpu_local_t *cpu = this_cpu();
+    task_t *task = this_cpu_read(current_task);
     uint64_t current_time = _get_cpu_time_ns();
-    uint64_t delta = current_time - _last_time;
-    if (current_task == NULL) {
-        _idle_time += delta;
+    uint64_t delta = current_time - cpu->last_time;
+    if (task == NULL) {
+        cpu->idle_time += delta;
     } else {
-        current_task->time_used += delta;
+        task->time_used += delta;
+        // deadline tasks run on their own reservation, which a group
+        // quota smaller than it would otherwise use up for the others
+        if (task->sched_class != SCHED_DEADLINE) {
+            _group_charge(task->group, delta);
+        }
     }
-    _last_time = current_time;
+    cpu->last_time = current_time;
 }
 
 static void _schedule()
 {
-    if (_scheduler_postpone_count != 0) {
+    cpu_local_t *cpu = this_cpu();
+    if (this_cpu_read(preempt_count) != 0) {
         // don't schedule if there's more work to be done
-        _scheduler_postponed = true;
+        this_cpu_write(sched_postponed, 1);
         return;
     }
-    if (current_task == NULL) {
+    // scheduling is never allowed inside an RCU read section, so
+    // getting here means this CPU has left any it was in
+    rcu_note_qs();
+    if (this_cpu_read(current_task) == NULL) {
         // we are currently idling and will schedule at a later time
         return;
     }
     // get the next task
-    task_t *task = _tasks_dequeue_ready();
+    task_t *task = _pick_next();
     // don't need to do anything if there's nothing ready to run
     if (task == NULL) {
-        if (current_task->state == TASK_RUNNING) {
+        if (this_cpu_read(current_task)->state == TASK_RUNNING) {
             // still running the same task
             // but also reset the time slice counter
-            _time_slice_remaining = TIME_SLICE_SIZE;
+            cpu->time_slice_remaining = TIME_SLICE_SIZE;
             return;
         }
         // disable time slices because there are no tasks available to run
-        _time_slice_remaining = 0;
+        cpu->time_slice_remaining = 0;
         // count the time that this task ran for
         tasks_update_time();
         /*** idle ***/
         // borrow this task to return to once we're not idle anymore
-        task_t *borrowed = current_task;
+        task_t *borrowed = this_cpu_read(current_task);
+        if (borrowed->sched_class == SCHED_DEADLINE) _dl_charge(borrowed, cpu->last_time);
+        _stat_switch_out(borrowed);
         // set the current task to null to indicate an idle state
-        current_task = NULL;
-        _idle_start = _get_cpu_time_ns();
+        this_cpu_write(current_task, NULL);
+        // interrupts are enabled while idling, which doesn't count
+        // towards the time the lock kept them disabled
+        _sched_lock_account(cpu);
         do {
-            // enable interrupts to process timer and other events
-            asm ("sti");
-            // immediately halt the CPU
-            asm ("hlt");
-            // disable interrupts to restore our lock
-            asm ("cli");
+            // idling is a quiescent state too, report it for any grace
+            // period that started while we were waiting
+            rcu_note_qs();
+            // let the idle driver wait for interrupts to make a task ready
+            idle_enter();
             // check if there's a task ready to be run
-        } while (task = _tasks_dequeue_ready(), task == NULL);
+        } while (task = _pick_next(), task == NULL);
+        cpu->sched_lock_tsc = __rdtsc();
         // count the time we spent idling
         tasks_update_time();
         // reset the current task
-        current_task = borrowed;
-        _idle_start = _idle_start - _get_cpu_time_ns();
-        _idle_time += _idle_start;
+        this_cpu_write(current_task, borrowed);
     } else {
         // just do time accounting once
         tasks_update_time();
+        task_t *current = this_cpu_read(current_task);
+        if (current->sched_class == SCHED_DEADLINE) _dl_charge(current, cpu->last_time);
+        _stat_switch_out(current);
     }
     // reset the time slice because a new task is being scheduled
-    _time_slice_remaining = TIME_SLICE_SIZE;
+    cpu->time_slice_remaining = TIME_SLICE_SIZE;
 #ifdef DEBUG
     rs232::printf("switching to ");
     _print_task(task);
 #endif
     // reset the last "timer time" since the time slice was reset
-    _last_timer_time = _get_cpu_time_ns();
+    cpu->last_timer_time = _get_cpu_time_ns();
+    // its budget is used up from here on
+    task->dl.exec_start = cpu->last_timer_time;
+    this_cpu_inc(nr_switches);
+    _stat_switch_in(task);
+    fpu_switch(task);
     // switch to the task
     tasks_switch_to(task);
 }
 
+static void _dl_release(task_t *task)
+{
+    _dl_total_bw -= task->dl.bw;
+    task->dl.bw = 0;
+    task->dl.throttled = false;
+}
+
+void tasks_set_class(task_t *task, task_class sched_class)
+{
+    if (sched_class == SCHED_DEADLINE) {
+        PANIC("Tasks enter the deadline class with tasks_set_deadline().\n");
+    }
+    _aquire_scheduler_lock();
+    if (task->sched_class == SCHED_DEADLINE) {
+        _dl_release(task);
+    }
+    if (task->state == TASK_READY && task->sched_class != sched_class) {
+        // move the task over to the matching ready queue
+        _remove_ready(task);
+        task->sched_class = sched_class;
+        _tasks_enqueue_ready(task);
+        _check_preempt(task);
+    } else {
+        task->sched_class = sched_class;
+        // a running task that was demoted may need to make room
+        if (task == this_cpu_read(current_task) &&
+            ((sched_class == SCHED_IDLE && _ready_mask != 0) || tasks_deadline.head != NULL)) {
+            _schedule();
+        }
+    }
+    _release_scheduler_lock();
+}
+
+int tasks_set_deadline(task_t *task, uint64_t runtime, uint64_t deadline, uint64_t period)
+{
+    if (runtime == 0 || runtime > deadline || deadline > period) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint32_t bw = (uint32_t)((runtime << TASK_DL_BW_SHIFT) / period);
+    _aquire_scheduler_lock();
+    // admission control: the new bandwidth replaces any the task had
+    uint32_t old_bw = task->sched_class == SCHED_DEADLINE ? task->dl.bw : 0;
+    if (_dl_total_bw - old_bw + bw > TASK_DL_BW_MAX) {
+        _release_scheduler_lock();
+        errno = EBUSY;
+        return -1;
+    }
+    _dl_total_bw = _dl_total_bw - old_bw + bw;
+    bool ready = task->state == TASK_READY;
+    if (ready) {
+        _remove_ready(task);
+    }
+    uint64_t now = _get_cpu_time_ns();
+    task->dl.runtime = runtime;
+    task->dl.deadline = deadline;
+    task->dl.period = period;
+    task->dl.bw = bw;
+    // the first period starts now
+    task->dl.period_end = now;
+    task->dl.exec_start = now;
+    task->sched_class = SCHED_DEADLINE;
+    _dl_refresh(task, now);
+    if (ready) {
+        _tasks_enqueue_ready(task);
+        _check_preempt(task);
+    }
+    _release_scheduler_lock();
+    return 0;
+}
+
+void tasks_wait_period()
+{
+    _aquire_scheduler_lock();
+    task_t *task = this_cpu_read(current_task);
+    if (task == NULL || task->sched_class != SCHED_DEADLINE) {
+        _release_scheduler_lock();
+        return;
+    }
+    uint64_t now = _get_cpu_time_ns();
+    if (now > task->dl.abs_deadline) {
+        task->dl.nr_missed++;
+    }
+    if (now < task->dl.period_end) {
+        // the rest of this period's budget is forfeit
+        task->state = TASK_SLEEPING;
+        task->wakeup_time = task->dl.period_end;
+        _enqueue_sleeping(task);
+        TASK_ACTION("wait period", task);
+        _schedule();
+    } else {
+        // running late, the next period has already started
+        _dl_charge(task, now);
+        _dl_refresh(task, now);
+    }
+    _release_scheduler_lock();
+}
+
+void tasks_cpu_group_init(cpu_group_t *group, const char *name, cpu_group_t *parent)
+{
+    *group = {
+        .name = name,
+        .parent = parent,
+        // no limit until one is set
+        .quota = 0,
+        .period = 0,
+        .remaining = 0,
+        .period_end = 0,
+        .throttled = false,
+        .throttled_since = 0,
+        .nr_tasks = 0,
+        .nr_children = 0,
+        .all_next = NULL,
+        .usage = 0,
+        .throttled_time = 0,
+        .nr_periods = 0,
+        .nr_throttled = 0,
+    };
+    _aquire_scheduler_lock();
+    if (parent != NULL) {
+        parent->nr_children++;
+    }
+    group->all_next = _all_cpu_groups;
+    _all_cpu_groups = group;
+    _release_scheduler_lock();
+}
+
+int tasks_cpu_group_destroy(cpu_group_t *group)
+{
+    _aquire_scheduler_lock();
+    if (group->nr_tasks != 0 || group->nr_children != 0) {
+        _release_scheduler_lock();
+        errno = EBUSY;
+        return -1;
+    }
+    for (cpu_group_t **link = &_all_cpu_groups; *link != NULL; link = &(*link)->all_next) {
+        if (*link == group) {
+            *link = group->all_next;
+            break;
+        }
+    }
+    if (group->parent != NULL) {
+        group->parent->nr_children--;
+    }
+    _release_scheduler_lock();
+    return 0;
+}
+
+int tasks_cpu_group_set_bandwidth(cpu_group_t *group, uint64_t quota, uint64_t period)
+{
+    if (period == 0 || quota > period) {
+        errno = EINVAL;
+        return -1;
+    }
+    _aquire_scheduler_lock();
+    uint64_t now = _get_cpu_time_ns();
+    if (group->throttled) {
+        group->throttled = false;
+        group->throttled_time += now - group->throttled_since;
+    }
+    group->quota = quota;
+    group->period = period;
+    // the first period starts now, with the full quota
+    group->period_end = now + period;
+    group->remaining = (int64_t)quota;
+    // tasks parked on the old limit are woken by the timer when its
+    // period would have ended and then held to the new one
+    _release_scheduler_lock();
+    return 0;
+}
+
+void tasks_cpu_group_attach(cpu_group_t *group, task_t *task)
+{
+    _aquire_scheduler_lock();
+    if (task->group != NULL) {
+        task->group->nr_tasks--;
+    }
+    // a task queued to run is held to the new group's quota when it is picked
+    task->group = group;
+    if (group != NULL) {
+        group->nr_tasks++;
+    }
+    _release_scheduler_lock();
+}
+
+cpu_group_stats_t tasks_cpu_group_stats(const cpu_group_t *group)
+{
+    _aquire_scheduler_lock();
+    uint64_t throttled_time = group->throttled_time;
+    if (group->throttled) {
+        // include the throttle that is still going on
+        throttled_time += _get_cpu_time_ns() - group->throttled_since;
+    }
+    cpu_group_stats_t stats = {
+        .usage = group->usage,
+        .throttled_time = throttled_time,
+        .nr_periods = group->nr_periods,
+        .nr_throttled = group->nr_throttled,
+        .nr_tasks = group->nr_tasks,
+        .throttled = group->throttled,
+    };
+    _release_scheduler_lock();
+    return stats;
+}
+
+// most groups tasks_cpu_group_dump() prints
+#define CPU_GROUP_DUMP_MAX 16
+
+void tasks_cpu_group_dump()
+{
+    // copied in a single walk, so the lock isn't held over the output
+    static struct {
+        const char *name;
+        uint64_t quota;
+        uint64_t period;
+        cpu_group_stats_t stats;
+    } copy[CPU_GROUP_DUMP_MAX];
+    size_t count = 0;
+    size_t skipped = 0;
+    _aquire_scheduler_lock();
+    for (cpu_group_t *group = _all_cpu_groups; group != NULL; group = group->all_next) {
+        if (count == CPU_GROUP_DUMP_MAX) {
+            skipped++;
+            continue;
+        }
+        copy[count].name = group->name;
+        copy[count].quota = group->quota;
+        copy[count].period = group->period;
+        copy[count].stats = tasks_cpu_group_stats(group);
+        count++;
+    }
+    _release_scheduler_lock();
+    for (size_t i = 0; i < count; i++) {
+        const cpu_group_stats_t *stats = &copy[i].stats;
+        rs232::printf("group %s %u %u %u %u %u %u %u %u\n", copy[i].name,
+            (uint32_t)(copy[i].quota / 1000), (uint32_t)(copy[i].period / 1000),
+            stats->nr_tasks, (uint32_t)(stats->usage / 1000), stats->nr_periods,
+            stats->nr_throttled, (uint32_t)(stats->throttled_time / 1000), stats->throttled);
+    }
+    if (skipped != 0) {
+        rs232::printf("group %u groups not shown\n", skipped);
+    }
+}
+
+int tasks_set_priority(task_t *task, uint32_t priority)
+{
+    if (priority > TASK_PRIO_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    _aquire_scheduler_lock();
+    // an inherited boost stays in place until the lock is released
+    bool boosted = task->priority > task->base_priority;
+    task->base_priority = priority;
+    if (!boosted || priority > task->priority) {
+        _change_priority(task, priority);
+    }
+    _release_scheduler_lock();
+    return 0;
+}
+
+void tasks_for_each(void (*fn)(task_t *task, void *arg), void *arg)
+{
+    // the list only changes in task context and the cleaner waits for
+    // a grace period, so keeping other tasks out is enough
+    rcu_read_lock();
+    for (task_t *task = rcu_dereference(_all_tasks); task != NULL;
+         task = rcu_dereference(task->all_next)) {
+        fn(task, arg);
+    }
+    rcu_read_unlock();
+}
+
+const char *tasks_state_name(task_state state)
+{
+    return state < TASK_STATE_COUNT ? _state_names[state] : "?";
+}
+
 void tasks_schedule()
 {
     // we must lock on all scheduling operations
@@ -414,15 +1275,21 @@ void tasks_schedule()
 
 uint64_t tasks_get_self_time()
 {
+    // the time is charged to the task's groups as well, which the
+    // timer updates too
+    _aquire_scheduler_lock();
     tasks_update_time();
-    return current_task->time_used;
+    uint64_t time_used = this_cpu_read(current_task)->time_used;
+    _release_scheduler_lock();
+    return time_used;
 }
 
 void tasks_block_current(task_state reason)
 {
     _aquire_scheduler_lock();
-    current_task->state = reason;
-    TASK_ACTION("block", current_task);
+    task_t *task = this_cpu_read(current_task);
+    task->state = reason;
+    TASK_ACTION("block", task);
     _schedule();
     _release_scheduler_lock();
 }
@@ -431,8 +1298,10 @@ void tasks_unblock(task_t *task)
 {
     _aquire_scheduler_lock();
     task->state = TASK_READY;
+    task->sched_stats.wakeup_tsc = __rdtsc();
     TASK_ACTION("unblock", task);
     _tasks_enqueue_ready(task);
+    _check_preempt(task);
     _release_scheduler_lock();
 }
 
@@ -440,46 +1309,64 @@ void _wakeup(task_t *task)
 {
     task->state = TASK_READY;
     task->wakeup_time = (0ULL - 1);
+    task->sched_stats.wakeup_tsc = __rdtsc();
     _tasks_enqueue_ready(task);
+    _check_preempt(task);
     TASK_ACTION("wakeup", task);
 }
 
-static void _on_timer()
+static void _on_timer(hrtimer_t *timer)
 {
+    (void)timer;
     _aquire_scheduler_lock();
 
-    task_t *pre = NULL;
-    task_t *task = tasks_sleeping.head;
-    task_t *next;
     bool need_schedule = false;
     uint64_t time = _get_cpu_time_ns();
     uint64_t time_delta;
 
-    while (task != NULL) {
-        next = task->next;
-        if (time >= task->wakeup_time) {
-            //rs232::printf("timer: waking sleeping task\n");
-            _remove_task(&tasks_sleeping, task, pre);
-            _wakeup(task);
-            task->next = NULL;
+    // the list is sorted, so this stops at the first task that isn't due
+    // and interrupts stay disabled only for as long as there are tasks to
+    // wake (a task may go straight back to sleep if it is throttled)
+    while (tasks_sleeping.head != NULL && time >= tasks_sleeping.head->wakeup_time) {
+        _wakeup(_dequeue_sleeping());
+        need_schedule = true;
+    }
+
+    // enforce the budget of a running deadline task, unless the timer
+    // interrupted a section with preemption disabled and it can't be
+    // switched out right now anyway
+    task_t *current = this_cpu_read(current_task);
+    if (current != NULL && current->sched_class == SCHED_DEADLINE &&
+        (this_cpu_read(preempt_count) & PREEMPT_MASK) == 1) {
+        _dl_charge(current, time);
+        if (current->dl.remaining <= 0) {
+            _dl_throttle(current);
+            need_schedule = true;
+        }
+    }
+    // and the quota of its group for any other task
+    if (current != NULL && current->group != NULL && current->state == TASK_RUNNING &&
+        (this_cpu_read(preempt_count) & PREEMPT_MASK) == 1) {
+        tasks_update_time();
+        cpu_group_t *group = _group_exhausted(current, time);
+        if (group != NULL) {
+            _group_throttle(current, group);
             need_schedule = true;
-        } else {
-            pre = task;
         }
-        task = next;
     }
 
-    if (_time_slice_remaining != 0) {
-        time_delta = time - _last_timer_time;
-        _last_timer_time = time;
-        if (time_delta >= _time_slice_remaining) {
+    cpu_local_t *cpu = this_cpu();
+    if (cpu->time_slice_remaining != 0) {
+        time_delta = time - cpu->last_timer_time;
+        cpu->last_timer_time = time;
+        if (time_delta >= cpu->time_slice_remaining) {
             // schedule (and maybe pre-empt)
             // the schedule function will reset the time slice
             //rs232::printf("timer: time slice expired\n");
             need_schedule = true;
         } else {
             // decrement the time slice counter
-            _time_slice_remaining -= time_delta;
+            cpu->time_slice_remaining -= time_delta;
         }
     }
 
@@ -490,14 +1377,25 @@ static void _on_timer()
     _release_scheduler_lock();
 }
 
+uint64_t tasks_get_time()
+{
+    return _get_cpu_time_ns();
+}
+
+uint64_t tasks_tsc_to_ns(uint64_t tsc)
+{
+    return _tsc_to_ns(tsc);
+}
+
 void tasks_nano_sleep_until(uint64_t time)
 {
     // TODO: maybe validate that this time is in the future?
     _aquire_scheduler_lock();
-    current_task->state = TASK_SLEEPING;
-    current_task->wakeup_time = time;
-    _enqueue_sleeping(current_task);
-    TASK_ACTION("sleep", current_task);
+    task_t *task = this_cpu_read(current_task);
+    task->state = TASK_SLEEPING;
+    task->wakeup_time = time;
+    _enqueue_sleeping(task);
+    TASK_ACTION("sleep", task);
     _schedule();
     _release_scheduler_lock();
 }
@@ -507,29 +1405,91 @@ void tasks_nano_sleep(uint64_t time)
     tasks_nano_sleep_until(_get_cpu_time_ns() + time);
 }
 
+void preempt_count_sub(uint32_t count)
+{
+#ifdef IRQSOFF_TRACE
+    if (this_cpu_read(preempt_count) == count) {
+        uint32_t flags = interrupts_save();
+        preemptoff_stop(IRQSOFF_THIS_IP);
+        interrupts_restore(flags);
+    }
+#endif
+    // an interrupt that postpones a schedule before this either is seen
+    // below, and one that comes in after it schedules on its own exit
+    this_cpu_sub(preempt_count, count);
+    if (this_cpu_read(preempt_count) == 0 && this_cpu_read(sched_postponed)) {
+        // releasing the lock runs the postponed schedule
+        _aquire_scheduler_lock();
+        _release_scheduler_lock();
+    }
+}
+
+irqoff_stats_t tasks_irqoff_stats()
+{
+    uint32_t flags = interrupts_save();
+    cpu_local_t *cpu = this_cpu();
+    irqoff_stats_t stats = {
+        .sched_lock_max = _tsc_to_ns(cpu->sched_lock_max),
+        .hardirq_max = _tsc_to_ns(cpu->hardirq_max),
+    };
+    interrupts_restore(flags);
+    return stats;
+}
+
+void tasks_irqoff_reset()
+{
+    uint32_t flags = interrupts_save();
+    this_cpu()->sched_lock_max = 0;
+    this_cpu()->hardirq_max = 0;
+    interrupts_restore(flags);
+}
+
 void tasks_exit()
 {
+    task_t *task = this_cpu_read(current_task);
     // userspace cleanup can happen here
-    rs232::printf("task \"%s\" (0x%08x) exiting\n", current_task->name, (uint32_t)current_task);
+#ifdef DEBUG
+    rs232::printf("task \"%s\" (0x%08x) exiting\n", task->name, (uint32_t)task);
+#endif
 
     _aquire_scheduler_lock();
     // all scheduling-specific operations must happen here
-    _enqueue_stopped(current_task);
+    if (task->sched_class == SCHED_DEADLINE) {
+        _dl_release(task);
+    }
+    if (task->group != NULL) {
+        task->group->nr_tasks--;
+        task->group = NULL;
+    }
+    _enqueue_stopped(task);
 
     // the ordering of these two should really be reversed
     // but the scheduler currently isn't very smart
     tasks_block_current(TASK_STOPPED);
 
-    tasks_unblock(&_cleaner_task);
+    // the cleaner picks up any new stopped tasks before it pauses again
+    if (_cleaner_task.state == TASK_PAUSED) {
+        // it normally waits for idle time, but not while the spawn pool
+        // runs dry and new tasks would have to take the slow path
+        if (_pool_stats.cached < TASK_POOL_SIZE / 2) {
+            _cleaner_task.sched_class = SCHED_NORMAL;
+        }
+        tasks_unblock(&_cleaner_task);
+    }
 
     _release_scheduler_lock();
 }
 
 static void _clean_stopped_task(task_t *task)
 {
+    // dynamically allocated tasks go back to the pool while there is room
+    if (task->alloc == ALLOC_DYNAMIC && _pool_put(task, true)) {
+        return;
+    }
     // free the stack page
     uintptr_t page = task->stack_top & PAGE_ALIGN;
     free_page((void *)page, PAGE_SIZE - 1);
+    fpu_task_free(task);
     // somehow determine if the task was dynamically allocated or not
     // just assume statically allocated tasks will never exit (bad idea)
     if (task->alloc == ALLOC_DYNAMIC) free(task);
@@ -538,20 +1498,48 @@ static void _clean_stopped_task(task_t *task)
 static void _cleaner_task_impl()
 {
     for (;;) {
-        task_t *task;
         _aquire_scheduler_lock();
+        // take every stopped task at once
+        task_t *task = tasks_stopped.head;
+        tasks_stopped.head = NULL;
+        tasks_stopped.tail = NULL;
+        if (task == NULL) {
+            // back to waiting for idle time (see tasks_exit())
+            _cleaner_task.sched_class = SCHED_IDLE;
+            // a schedule occuring at this point would be okay
+            // it just needs to occur before the loop repeats
+            tasks_block_current(TASK_PAUSED);
+            _release_scheduler_lock();
+            continue;
+        }
+        _release_scheduler_lock();
 
-        while (tasks_stopped.head != NULL) {
-            task = _dequeue_stopped();
+        // nobody can find them anymore once they are off the list of all
+        // tasks. Each unlink walks that list, so the lock is dropped in
+        // between rather than held for all of them at once.
+        for (task_t *stopped = task; stopped != NULL; stopped = stopped->next) {
+            _aquire_scheduler_lock();
+            task_t **link = &_all_tasks;
+            while (*link != NULL && *link != stopped) {
+                link = &(*link)->all_next;
+            }
+            if (*link != NULL) {
+                rcu_assign_pointer(*link, stopped->all_next);
+            }
+            _release_scheduler_lock();
+        }
+
+        // readers may still be looking at these tasks without holding
+        // any lock, so wait until they are all done before freeing them
+        synchronize_rcu();
+        while (task != NULL) {
+            task_t *next = task->next;
+#ifdef DEBUG
             rs232::printf("cleaning up task %s (0x%08x)\n", task->name ? task->name : "N/A", (uint32_t)task);
+#endif
             _clean_stopped_task(task);
+            task = next;
         }
-
-        // a schedule occuring at this point would be okay
-        // it just needs to occur before the loop repeats
-        tasks_block_current(TASK_PAUSED);
-
-        _release_scheduler_lock();
     }
 }
 
@@ -563,13 +1551,140 @@ void tasks_sync_block(tasks_sync_t *ts)
         rs232::printf("blocking %s\n", ts->dbg_name);
     }
 #endif
+    task_t *task = this_cpu_read(current_task);
+    task->sync_handoff = false;
     // push the current task to the waiting queue
-    _enqueue_task(&ts->waiting, current_task);
+    _enqueue_task(&ts->waiting, task);
+    task->blocked_on = ts;
+    _boost_update(ts);
+    _inherit_priority(ts, _sync_priority(task));
     // now block until the mutex is freed
     tasks_block_current(TASK_BLOCKED);
     _release_scheduler_lock();
 }
 
+int tasks_sync_wait(tasks_sync_t *ts, const volatile uint32_t *word, uint32_t expected)
+{
+    return tasks_sync_wait_until(ts, word, expected, TASKS_NO_TIMEOUT);
+}
+
+int tasks_sync_wait_until(tasks_sync_t *ts, const volatile uint32_t *word, uint32_t expected,
+    uint64_t deadline)
+{
+    _aquire_scheduler_lock();
+    task_t *task = this_cpu_read(current_task);
+    // the waker changes the word before waking the queue, so if it still
+    // holds the expected value here no wake up can have been missed
+    if (task == NULL || *word != expected) {
+        _release_scheduler_lock();
+        errno = EAGAIN;
+        return -1;
+    }
+    if (deadline != TASKS_NO_TIMEOUT && deadline <= _get_cpu_time_ns()) {
+        _release_scheduler_lock();
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    task->sync_handoff = false;
+    task->timed_out = false;
+    _enqueue_task(&ts->waiting, task);
+    task->blocked_on = ts;
+    _boost_update(ts);
+    _inherit_priority(ts, _sync_priority(task));
+    if (deadline != TASKS_NO_TIMEOUT) {
+        hrtimer_start(&task->timeout, deadline, 0);
+    }
+    tasks_block_current(TASK_BLOCKED);
+    if (deadline != TASKS_NO_TIMEOUT) {
+        hrtimer_cancel(&task->timeout);
+    }
+    int status = task->sync_handoff ? 1 : 0;
+    bool timed_out = task->timed_out;
+    _release_scheduler_lock();
+    if (timed_out) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return status;
+}
+
+static void _sync_timeout(hrtimer_t *timer)
+{
+    task_t *task = (task_t *)timer->data;
+    _aquire_scheduler_lock();
+    tasks_sync_t *ts = task->blocked_on;
+    // a waker that got there first has already dequeued it
+    if (task->state == TASK_BLOCKED && ts != NULL) {
+        task_t *pre = NULL;
+        task_t *iter = ts->waiting.head;
+        while (iter != NULL && iter != task) {
+            pre = iter;
+            iter = iter->next;
+        }
+        if (iter == NULL) {
+            PANIC("Blocked task is missing from its wait queue.\n");
+        }
+        _remove_task(&ts->waiting, task, pre);
+        task->blocked_on = NULL;
+        task->timed_out = true;
+        _wakeup(task);
+        // the possessor no longer needs to run at this waiter's priority,
+        // but may still owe a boost to waiters on other queues it holds
+        task_t *owner = ts->boosts;
+        _boost_update(ts);
+        if (owner != NULL) {
+            _unboost(owner);
+        }
+    }
+    _release_scheduler_lock();
+}
+
+size_t tasks_sync_wake(tasks_sync_t *ts, size_t count)
+{
+    size_t woken = 0;
+    _aquire_scheduler_lock();
+    while (woken < count) {
+        task_t *task = _dequeue_waiter(ts);
+        if (task == NULL) break;
+        _wakeup(task);
+        woken++;
+    }
+    task_t *owner = ts->boosts;
+    _boost_update(ts);
+    if (owner != NULL) {
+        _unboost(owner);
+    }
+    _release_scheduler_lock();
+    return woken;
+}
+
+task_t *tasks_sync_handoff(tasks_sync_t *ts)
+{
+    _aquire_scheduler_lock();
+    task_t *task = _dequeue_waiter(ts);
+    // the waiter owns the resource as soon as it is dequeued, so nobody
+    // can barge in before it gets to run. Without one it is free, and
+    // either way tasks queueing up from now on no longer boost the caller.
+    ts->possessor = task;
+    if (task != NULL) {
+        task->sync_handoff = true;
+        _wakeup(task);
+    }
+    // the caller is releasing the resource, so it gives up the boost
+    // for this queue but keeps those owed for other queues it holds
+    task_t *releaser = ts->boosts;
+    _boost_update(ts);
+    if (releaser != NULL) {
+        _unboost(releaser);
+    }
+    if (task != NULL) {
+        // the new owner inherits from whoever is still waiting behind it
+        _inherit_priority(ts, _waiters_priority(ts));
+    }
+    _release_scheduler_lock();
+    return task;
+}
+
 void tasks_sync_unblock(tasks_sync_t *ts)
 {
     _aquire_scheduler_lock();
@@ -581,18 +1696,26 @@ void tasks_sync_unblock(tasks_sync_t *ts)
     // iterate all tasks that were blocked and unblock them
     task_t *task = ts->waiting.head;
     task_t *next = NULL;
+    task_t *owner;
     if (task == NULL) {
         // no other tasks were blocked
         goto exit;
     }
     do {
+        // _wakeup owns the link from here on, it may even put a throttled
+        // task on the sorted sleeping list
         next = task->next;
+        task->blocked_on = NULL;
         _wakeup(task);
-        task->next = NULL;
         task = next;
     } while (task != NULL);
     ts->waiting.head = NULL;
     ts->waiting.tail = NULL;
+    owner = ts->boosts;
+    _boost_update(ts);
+    if (owner != NULL) {
+        _unboost(owner);
+    }
     // we woke up some tasks
     _schedule();
 exit:
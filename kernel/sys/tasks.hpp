@@ -13,8 +13,12 @@
 #include <stdint.h>         // Data type definitions
 #include <arch/arch.hpp>    // Architecture specific features
 #include <mem/paging.hpp>
+#include <sys/schedstat.hpp>
+#include <sys/hrtimer.hpp>
 
 #define TIME_SLICE_SIZE (1 * 1000 * 1000ULL)
+// deadline passed to the timed wait functions to wait forever
+#define TASKS_NO_TIMEOUT UINT64_MAX
 
 enum task_state
 {
@@ -29,6 +33,110 @@ enum task_state
 
 enum task_alloc { ALLOC_STATIC, ALLOC_DYNAMIC };
 
+/**
+ * @brief Scheduling classes. Deadline tasks run ahead of everything else,
+ * earliest deadline first, for as long as they have budget left in their
+ * current period. Tasks in the idle class only run when no normal task is
+ * runnable and are preempted as soon as one wakes up.
+ */
+enum task_class
+{
+    SCHED_DEADLINE = 0,
+    SCHED_NORMAL,
+    SCHED_IDLE,
+    SCHED_CLASS_COUNT
+};
+
+/**
+ * @brief Static priorities of normal class tasks. Higher values are more
+ * urgent; a ready task always runs before any ready task of lower priority.
+ */
+#define TASK_PRIO_LEVELS    8
+#define TASK_PRIO_MIN       0
+#define TASK_PRIO_DEFAULT   2
+#define TASK_PRIO_MAX       (TASK_PRIO_LEVELS - 1)
+
+/**
+ * @brief Fixed point shift of deadline class bandwidths (runtime / period).
+ * Admission control keeps the sum of all deadline task bandwidths at or
+ * below TASK_DL_BW_MAX, which leaves the rest of the CPU to other tasks.
+ */
+#define TASK_DL_BW_SHIFT    20
+#define TASK_DL_BW_MAX      ((95U << TASK_DL_BW_SHIFT) / 100)
+
+/**
+ * @brief Parameters and state of a deadline class task. Every period it
+ * may run for up to runtime nanoseconds, and is due deadline nanoseconds
+ * after the period started.
+ */
+typedef struct task_dl
+{
+    uint64_t runtime;       // budget per period
+    uint64_t deadline;      // relative to the start of each period
+    uint64_t period;
+    uint64_t abs_deadline;  // deadline of the current period
+    uint64_t period_end;    // start of the next period
+    int64_t remaining;      // budget left in the current period
+    uint64_t exec_start;    // last time the budget was charged
+    uint32_t bw;            // admitted bandwidth (see TASK_DL_BW_SHIFT)
+    bool throttled;         // out of budget until period_end
+    uint32_t nr_throttled;  // periods in which the budget ran out
+    uint32_t nr_missed;     // periods whose work was done past the deadline
+} task_dl_t;
+
+/**
+ * @brief A group of tasks sharing a CPU bandwidth limit. Every period the
+ * tasks in the group may run for quota nanoseconds in total; once that is
+ * used up they are throttled until the next period. Groups nest, and a
+ * task is throttled when any group it is in has run out. Run time is
+ * charged to the task's group and every group above it. Deadline class
+ * tasks are charged but never throttled, their budget is their own.
+ */
+typedef struct cpu_group cpu_group_t;
+struct cpu_group
+{
+    const char *name;
+    cpu_group_t *parent;    // NULL for a top level group
+    uint64_t quota;         // nanoseconds per period, 0 for no limit
+    uint64_t period;
+    int64_t remaining;      // quota left in the current period
+    uint64_t period_end;    // start of the next period
+    bool throttled;         // out of quota until period_end
+    uint64_t throttled_since;
+    uint32_t nr_tasks;      // tasks directly in the group
+    uint32_t nr_children;   // groups directly below it
+    cpu_group_t *all_next;  // next in the list of every group
+    // statistics
+    uint64_t usage;         // nanoseconds run by its tasks, including subgroups
+    uint64_t throttled_time;
+    uint32_t nr_periods;    // periods elapsed with a quota set
+    uint32_t nr_throttled;  // periods in which the quota ran out
+};
+
+typedef struct cpu_group_stats
+{
+    uint64_t usage;
+    uint64_t throttled_time;
+    uint32_t nr_periods;
+    uint32_t nr_throttled;
+    uint32_t nr_tasks;
+    bool throttled;
+} cpu_group_stats_t;
+
+// exited tasks kept around (TCB, stack and FPU area) for reuse
+#define TASK_POOL_SIZE      32
+// tasks put in the pool up front by tasks_init()
+#define TASK_POOL_PREFILL   8
+
+typedef struct task_pool_stats
+{
+    uint32_t cached;    // tasks in the pool right now
+    uint32_t hits;      // spawns served from the pool
+    uint32_t misses;    // spawns that had to allocate
+    uint32_t recycled;  // exited tasks returned to the pool
+} task_pool_stats_t;
+
+typedef struct tasks_sync tasks_sync_t;
 typedef struct task task_t;
 struct task
 {
@@ -40,11 +148,24 @@ struct task
     uint64_t wakeup_time;
     const char *name;
     task_alloc alloc;
+    task_class sched_class;
+    bool sync_handoff;      // woken by tasks_sync_handoff()
+    uint32_t priority;      // effective priority, including inheritance
+    uint32_t base_priority; // priority set with tasks_set_priority()
+    tasks_sync_t *blocked_on; // wait queue the task is blocked on
+    tasks_sync_t *boosters; // inherit queues it possesses that have waiters
+    task_t *all_next;       // next in the list of every existing task
+    sched_task_stats_t sched_stats;
+    void *fpu_state;        // FPU register save area (see fpu.hpp)
+    void *fpu_alloc;        // allocation backing fpu_state
+    task_dl_t dl;           // deadline class parameters (see tasks_set_deadline())
+    hrtimer_t timeout;      // ends a timed wait on a wait queue
+    bool timed_out;         // the last timed wait ran out of time
+    cpu_group_t *group;     // bandwidth group, NULL if not in one
 };
 
-extern task_t *current_task;
-
-#define TASK_ONLY if (current_task != NULL)
+// the running task lives in the per-CPU data area (see cpu_local_t)
+#define TASK_ONLY if (this_cpu_read(current_task) != NULL)
 
 typedef struct tasklist
 {
@@ -53,18 +174,32 @@ typedef struct tasklist
 } tasklist_t;
 
 #define MAX_TASKS_QUEUED 8
-typedef struct tasks_sync
+/**
+ * @brief A wait queue. Waiters are woken most urgent first, in FIFO order
+ * among equal priorities. With inherit set, the possessor runs at no less
+ * than the priority of its most urgent waiter (following chains of
+ * possessors that are themselves blocked on such queues).
+ */
+struct tasks_sync
 {
     task_t* possessor;
     const char *dbg_name;
     tasklist_t waiting;
-} tasks_sync_t;
+    // boost the possessor to the priority of its most urgent waiter
+    bool inherit;
+    // possessor whose boosters list it is on, and the next queue there
+    task_t *boosts;
+    tasks_sync_t *booster_next;
+};
 
 static inline void tasks_sync_init(tasks_sync_t *ts) {
     *ts = {
         .possessor = NULL,
         .dbg_name = NULL,
         .waiting = { },
+        .inherit = false,
+        .boosts = NULL,
+        .booster_next = NULL,
     };
 }
 
@@ -91,6 +226,144 @@ extern "C" void tasks_switch_to(task_t *task);
  * @return task_t* Pointer to the created kernel task
  */
 task_t *tasks_new(void (*entry)(void), task_t *storage, task_state state, const char *name);
+/**
+ * @brief Creates a new kernel task just like tasks_new(), except that the
+ * entry point is passed the provided argument when the task starts.
+ *
+ * @param entry Task function entry point
+ * @param arg Argument passed to the entry point
+ * @param storage Task stack structure (if NULL, a pointer to the task is returned)
+ * @param state Task state structure
+ * @return task_t* Pointer to the created kernel task
+ */
+task_t *tasks_new_arg(void (*entry)(void *), void *arg, task_t *storage, task_state state, const char *name);
+/**
+ * @brief Puts up to count more tasks in the spawn pool, so that as many
+ * dynamically allocated tasks can be created without allocating memory.
+ * Tasks created with tasks_new(..., NULL, ...) are taken from the pool
+ * and returned to it when they exit, up to TASK_POOL_SIZE of them.
+ *
+ * @param count Number of tasks to add
+ */
+void tasks_pool_reserve(size_t count);
+/**
+ * @brief Returns the spawn pool counters.
+ *
+ * @return task_pool_stats_t Copy of the counters
+ */
+task_pool_stats_t tasks_pool_stats();
+/**
+ * @brief Moves a task into a different scheduling class. If the task is
+ * currently queued to run it is moved to the matching ready queue. Tasks
+ * only enter the deadline class through tasks_set_deadline(); leaving it
+ * gives the task's bandwidth back.
+ *
+ * @param task Task to be changed
+ * @param sched_class New scheduling class
+ */
+void tasks_set_class(task_t *task, task_class sched_class);
+/**
+ * @brief Sets the static priority of a normal class task. A task that is
+ * boosted by priority inheritance keeps the boost until it releases the
+ * lock it was boosted for.
+ *
+ * @param task Task to be changed
+ * @param priority Priority from TASK_PRIO_MIN to TASK_PRIO_MAX
+ * @return int Returns 0 on success and -1 with errno set to EINVAL if
+ * the priority is out of range.
+ */
+int tasks_set_priority(task_t *task, uint32_t priority);
+/**
+ * @brief Moves a task into the deadline class, or changes its parameters
+ * if it already is in it. Its first period starts right away. The budget
+ * is enforced on the timer tick, so a task may overrun it by up to a tick
+ * before it is throttled until its next period.
+ *
+ * @param task Task to be changed
+ * @param runtime Nanoseconds the task may run for every period
+ * @param deadline Nanoseconds after the start of a period that its work is due
+ * @param period Nanoseconds between the start of two periods
+ * @return int Returns 0 on success and -1 with errno set to EINVAL if
+ * runtime <= deadline <= period does not hold, or to EBUSY if admitting
+ * the task would exceed TASK_DL_BW_MAX.
+ */
+int tasks_set_deadline(task_t *task, uint64_t runtime, uint64_t deadline, uint64_t period);
+/**
+ * @brief Called by a deadline task once the work of its current period is
+ * done. Sleeps until the next period starts with a full budget.
+ *
+ */
+void tasks_wait_period(void);
+/**
+ * @brief Initializes a bandwidth group without a limit.
+ *
+ * @param group Group to initialize
+ * @param name Name of the group (for statistics)
+ * @param parent Group to nest it in, or NULL
+ */
+void tasks_cpu_group_init(cpu_group_t *group, const char *name, cpu_group_t *parent);
+/**
+ * @brief Removes a group that no longer has tasks or subgroups in it.
+ *
+ * @param group Group to remove
+ * @return int Returns 0 on success and -1 with errno set to EBUSY if
+ * tasks or subgroups are still in it.
+ */
+int tasks_cpu_group_destroy(cpu_group_t *group);
+/**
+ * @brief Sets the CPU bandwidth limit of a group. Its first period starts
+ * right away. Like deadline budgets it is enforced on the timer tick, and
+ * an overrun is paid back in the next period.
+ *
+ * @param group Group to limit
+ * @param quota Nanoseconds its tasks may run for every period, 0 to
+ * remove the limit
+ * @param period Length of a period in nanoseconds
+ * @return int Returns 0 on success and -1 with errno set to EINVAL if
+ * quota is larger than period or the period is 0.
+ */
+int tasks_cpu_group_set_bandwidth(cpu_group_t *group, uint64_t quota, uint64_t period);
+/**
+ * @brief Moves a task into a group. Tasks start out in the group of the
+ * task that created them. Deadline class tasks are neither limited by
+ * nor charged to their group while they are in that class.
+ *
+ * @param group Group to move the task to, or NULL to take it out of its group
+ * @param task Task to move
+ */
+void tasks_cpu_group_attach(cpu_group_t *group, task_t *task);
+/**
+ * @brief Gets the statistics of a group.
+ *
+ * @param group Group to read
+ * @return cpu_group_stats_t Copy of its statistics
+ */
+cpu_group_stats_t tasks_cpu_group_stats(const cpu_group_t *group);
+/**
+ * @brief Prints the statistics of every group to serial, one line per group:
+ * "group <name> <quota> <period> <tasks> <usage> <periods> <throttled periods>
+ * <throttled time> <throttled now>", with times in microseconds. Groups
+ * past the first 16 are only counted.
+ *
+ */
+void tasks_cpu_group_dump();
+/**
+ * @brief Calls a function for every task that exists, including stopped
+ * tasks that haven't been cleaned up yet. Preemption is disabled
+ * throughout (tasks are only freed after an RCU grace period), so fn must
+ * not block. Interrupts stay enabled and may wake tasks meanwhile.
+ *
+ * @param fn Function to call
+ * @param arg Argument passed to fn
+ */
+void tasks_for_each(void (*fn)(task_t *task, void *arg), void *arg);
+/**
+ * @brief Gets the name of a task state.
+ *
+ * @param state Task state
+ * @return const char* Name of the state, such as "READY"
+ */
+const char *tasks_state_name(task_state state);
 /**
  * @brief Tell the kernel task scheduler to schedule all of the added tasks.
  *
@@ -114,6 +387,19 @@ void tasks_block_current(task_state reason);
  * @param task
  */
 void tasks_unblock(task_t *task);
+/**
+ * @brief Returns the current time, in nanoseconds since boot.
+ *
+ * @return uint64_t Current time in nanoseconds
+ */
+uint64_t tasks_get_time(void);
+/**
+ * @brief Converts a span of TSC cycles to nanoseconds.
+ *
+ * @param tsc Cycles
+ * @return uint64_t Nanoseconds
+ */
+uint64_t tasks_tsc_to_ns(uint64_t tsc);
 /**
  * @brief Sleeps until the provided absolute time (in nanoseconds).
  *
@@ -131,7 +417,137 @@ void tasks_nano_sleep(uint64_t time);
  *
  */
 void tasks_exit(void);
+// preempt_count holds the preempt_disable() nesting in its low bits and
+// counts hardware interrupts in progress from this bit up
+#define PREEMPT_HARDIRQ_OFFSET (1U << 16)
+#define PREEMPT_MASK (PREEMPT_HARDIRQ_OFFSET - 1)
+
+/**
+ * @brief Disables preemption on this CPU until the matching call to
+ * preempt_enable(). Interrupts are left enabled, but tasks that are
+ * woken in the meantime will only be switched to afterwards. Sections
+ * may nest and must not block.
+ *
+ */
+static inline void preempt_disable()
+{
+    this_cpu_inc(preempt_count);
+#ifdef IRQSOFF_TRACE
+    if (this_cpu_read(preempt_count) == 1) {
+        preemptoff_start(IRQSOFF_THIS_IP);
+    }
+#endif
+    asm volatile("" ::: "memory");
+}
+/**
+ * @brief Drops count from the preemption count and, once it reaches 0,
+ * switches to any task that was woken in the meantime. Interrupts are
+ * left alone unless there is a task to switch to.
+ *
+ * @param count Amount to drop the count by
+ */
+void preempt_count_sub(uint32_t count);
+/**
+ * @brief Ends a section started with preempt_disable() and runs the
+ * scheduler if it was requested in the meantime.
+ *
+ */
+static inline void preempt_enable()
+{
+    asm volatile("" ::: "memory");
+    preempt_count_sub(1);
+}
+/**
+ * @brief Checks whether running tasks can be switched out on this CPU.
+ *
+ * @return true Neither preemption is disabled nor is an interrupt being handled
+ */
+static inline bool preemptible()
+{
+    return this_cpu_read(preempt_count) == 0;
+}
+
+typedef struct irqoff_stats
+{
+    uint64_t sched_lock_max;    // longest the scheduler lock kept interrupts disabled
+    uint64_t hardirq_max;       // longest hardware interrupt handler
+} irqoff_stats_t;
+
+/**
+ * @brief Gets the longest spans (in nanoseconds) this CPU ran with
+ * interrupts disabled, which bound its interrupt latency.
+ *
+ * @return irqoff_stats_t Copy of the maxima
+ */
+irqoff_stats_t tasks_irqoff_stats();
+/**
+ * @brief Clears the maxima returned by tasks_irqoff_stats().
+ *
+ */
+void tasks_irqoff_reset();
 
 void tasks_sync_block(tasks_sync_t *tsc);
 
 void tasks_sync_unblock(tasks_sync_t *tsc);
+/**
+ * @brief Blocks the current task on a wait queue, but only if *word still
+ * equals expected once the scheduler lock is held. Checking and queueing
+ * happen atomically, so a waker that changes *word and then wakes the
+ * queue can never be missed (the same contract as a futex wait).
+ *
+ * @param ts Wait queue
+ * @param word Word to check
+ * @param expected Value *word must have for the task to block
+ * @return int Returns 1 if the waker handed ownership over with
+ * tasks_sync_handoff(), 0 on any other wake up, and -1 with errno set to
+ * EAGAIN if *word had already changed (or there is no task to block).
+ */
+int tasks_sync_wait(tasks_sync_t *ts, const volatile uint32_t *word, uint32_t expected);
+/**
+ * @brief Same as tasks_sync_wait(), except that the task gives up waiting
+ * at the given time. It is woken by whichever comes first, a waker or
+ * the timeout.
+ *
+ * @param ts Wait queue
+ * @param word Word to check
+ * @param expected Value *word must have for the task to block
+ * @param deadline Absolute time (nanoseconds since boot) to stop waiting
+ * at, or TASKS_NO_TIMEOUT
+ * @return int Returns 1 on handoff and 0 on any other wake up like
+ * tasks_sync_wait(). Returns -1 with errno set to EAGAIN if *word had
+ * already changed, or to ETIMEDOUT if the deadline passed first.
+ */
+int tasks_sync_wait_until(tasks_sync_t *ts, const volatile uint32_t *word, uint32_t expected,
+    uint64_t deadline);
+/**
+ * @brief Wakes up to count tasks from a wait queue, most urgent first and
+ * in FIFO order among equal priorities.
+ *
+ * @param ts Wait queue
+ * @param count Maximum number of tasks to wake
+ * @return size_t Number of tasks woken
+ */
+size_t tasks_sync_wake(tasks_sync_t *ts, size_t count);
+/**
+ * @brief Wakes the most urgent task on a wait queue, or the one that has
+ * waited longest among equally urgent ones.
+ *
+ * @param ts Wait queue
+ * @return true A task was woken
+ * @return false The queue was empty
+ */
+static inline bool tasks_sync_wake_one(tasks_sync_t *ts)
+{
+    return tasks_sync_wake(ts, 1) != 0;
+}
+/**
+ * @brief Transfers ownership of whatever ts protects straight to the most
+ * urgent waiting task (the one that has waited longest among equal
+ * priorities) and wakes it. The task becomes the possessor and
+ * its tasks_sync_wait() returns 1, otherwise the possessor is cleared. The
+ * caller must not release the resource itself if a task was returned.
+ *
+ * @param ts Wait queue
+ * @return task_t* The new owner, or NULL if nobody was waiting
+ */
+task_t *tasks_sync_handoff(tasks_sync_t *ts);
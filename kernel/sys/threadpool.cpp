@@ -0,0 +1,213 @@
+/**
+ * @file threadpool.cpp
+ * @author Panix Contributors
+ * @brief Kernel thread pool with fork/join task groups and parallel_for
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/threadpool.hpp>
+#include <lib/RingBuffer.hpp>
+#include <arch/arch.hpp>
+
+typedef struct tp_job
+{
+    void (*func)(void *);
+    void (*range_func)(void *, size_t, size_t);
+    void *arg;
+    size_t begin;
+    size_t end;
+    task_group_t *group;
+} tp_job_t;
+
+typedef struct tp_worker
+{
+    task_t *task;
+    RingBuffer<tp_job_t, THREADPOOL_QUEUE_SIZE> queue;
+} tp_worker_t;
+
+static tp_worker_t _workers[THREADPOOL_MAX_WORKERS];
+static size_t _worker_count = 0;
+static size_t _next_queue = 0;
+// idle workers wait here for jobs to be submitted
+static tasks_sync_t _idle;
+
+static void _worker_impl(void *arg);
+
+static tp_worker_t *_current_worker()
+{
+    task_t *task = this_cpu_read(current_task);
+    for (size_t i = 0; i < _worker_count; i++) {
+        if (_workers[i].task == task) {
+            return &_workers[i];
+        }
+    }
+    return NULL;
+}
+
+// must be called with interrupts disabled
+static bool _take_job(tp_worker_t *self, tp_job_t *job)
+{
+    // prefer our own queue, then steal from the others
+    if (self != NULL && self->queue.Dequeue(job) == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < _worker_count; i++) {
+        if (&_workers[i] != self && _workers[i].queue.Dequeue(job) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _finish_job(task_group_t *group)
+{
+    uint32_t flags = interrupts_save();
+    bool wake = --group->pending == 0 && group->done.waiting.head != NULL;
+    interrupts_restore(flags);
+    if (wake) {
+        tasks_sync_unblock(&group->done);
+    }
+}
+
+static void _run_job(const tp_job_t *job)
+{
+    if (job->range_func != NULL) {
+        job->range_func(job->arg, job->begin, job->end);
+    } else {
+        job->func(job->arg);
+    }
+    _finish_job(job->group);
+}
+
+static void _submit(tp_job_t *job)
+{
+    uint32_t flags = interrupts_save();
+    job->group->pending++;
+    bool queued = false;
+    if (_worker_count != 0) {
+        // jobs forked by a worker go onto its own queue first
+        tp_worker_t *self = _current_worker();
+        if (self != NULL) {
+            queued = self->queue.Enqueue(*job) == 0;
+        }
+        for (size_t i = 0; !queued && i < _worker_count; i++) {
+            tp_worker_t *worker = &_workers[_next_queue];
+            _next_queue = (_next_queue + 1) % _worker_count;
+            queued = worker->queue.Enqueue(*job) == 0;
+        }
+    }
+    bool wake = queued && _idle.waiting.head != NULL;
+    interrupts_restore(flags);
+    if (!queued) {
+        // every queue is full (or there is no pool yet), so do it ourselves
+        _run_job(job);
+    } else if (wake) {
+        // one job only needs one worker
+        tasks_sync_wake_one(&_idle);
+    }
+}
+
+void threadpool_init(size_t workers)
+{
+    if (workers > THREADPOOL_MAX_WORKERS) {
+        workers = THREADPOOL_MAX_WORKERS;
+    }
+    tasks_sync_init(&_idle);
+    _idle.dbg_name = "threadpool";
+    for (size_t i = 0; i < workers; i++) {
+        _workers[i].task = tasks_new_arg(_worker_impl, &_workers[i], NULL, TASK_PAUSED, "[pool]");
+    }
+    // only let the workers run once the whole pool is set up
+    _worker_count = workers;
+    for (size_t i = 0; i < workers; i++) {
+        tasks_unblock(_workers[i].task);
+    }
+}
+
+size_t threadpool_workers()
+{
+    return _worker_count;
+}
+
+void task_group_init(task_group_t *group)
+{
+    group->pending = 0;
+    tasks_sync_init(&group->done);
+}
+
+void task_group_run(task_group_t *group, void (*func)(void *), void *arg)
+{
+    tp_job_t job = {
+        .func = func,
+        .range_func = NULL,
+        .arg = arg,
+        .begin = 0,
+        .end = 0,
+        .group = group,
+    };
+    _submit(&job);
+}
+
+void task_group_wait(task_group_t *group)
+{
+    tp_worker_t *self = _current_worker();
+    for (;;) {
+        tp_job_t job;
+        interrupts_off();
+        if (group->pending == 0) {
+            interrupts_on();
+            return;
+        }
+        // help out rather than sleep while there is queued work
+        if (_take_job(self, &job)) {
+            interrupts_on();
+            _run_job(&job);
+            continue;
+        }
+        // the remaining jobs are running elsewhere, wait for them
+        // (interrupts stay off until we are on the wait list)
+        tasks_sync_block(&group->done);
+    }
+}
+
+void parallel_for(size_t begin, size_t end, size_t grain,
+                  void (*func)(void *, size_t, size_t), void *arg)
+{
+    if (grain == 0) {
+        grain = 1;
+    }
+    task_group_t group;
+    task_group_init(&group);
+    for (size_t lo = begin; lo < end; lo += grain) {
+        size_t hi = (end - lo > grain) ? lo + grain : end;
+        tp_job_t job = {
+            .func = NULL,
+            .range_func = func,
+            .arg = arg,
+            .begin = lo,
+            .end = hi,
+            .group = &group,
+        };
+        _submit(&job);
+    }
+    task_group_wait(&group);
+}
+
+static void _worker_impl(void *arg)
+{
+    tp_worker_t *self = (tp_worker_t *)arg;
+    for (;;) {
+        tp_job_t job;
+        interrupts_off();
+        if (!_take_job(self, &job)) {
+            // interrupts stay off until we are on the wait list
+            tasks_sync_block(&_idle);
+            continue;
+        }
+        interrupts_on();
+        _run_job(&job);
+    }
+}
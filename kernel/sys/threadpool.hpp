@@ -0,0 +1,90 @@
+/**
+ * @file threadpool.hpp
+ * @author Panix Contributors
+ * @brief Kernel thread pool with fork/join task groups and parallel_for.
+ * Each worker owns a job queue; idle workers steal from the others and a
+ * task waiting on a group helps run queued jobs instead of just blocking.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/tasks.hpp>
+
+#define THREADPOOL_MAX_WORKERS  4
+#define THREADPOOL_QUEUE_SIZE   64
+
+/**
+ * @brief A set of jobs that can be waited on together.
+ *
+ */
+typedef struct task_group
+{
+    uint32_t pending;       // jobs submitted but not yet finished
+    tasks_sync_t done;      // tasks waiting for pending to reach 0
+} task_group_t;
+
+/**
+ * @brief Starts the pool's worker tasks. Must be called after tasks_init().
+ *
+ * @param workers Number of workers (at most THREADPOOL_MAX_WORKERS)
+ */
+void threadpool_init(size_t workers);
+/**
+ * @brief Returns the number of pool workers.
+ *
+ * @return size_t Number of workers
+ */
+size_t threadpool_workers();
+/**
+ * @brief Initializes an empty task group.
+ *
+ * @param group Task group
+ */
+void task_group_init(task_group_t *group);
+/**
+ * @brief Forks a job into a task group. If every queue is full the job
+ * is run immediately by the calling task.
+ *
+ * @param group Task group the job belongs to
+ * @param func Job function
+ * @param arg Argument passed to the job
+ */
+void task_group_run(task_group_t *group, void (*func)(void *), void *arg);
+/**
+ * @brief Joins a task group, returning once every job in it has finished.
+ * The calling task runs queued jobs while it waits.
+ *
+ * @param group Task group
+ */
+void task_group_wait(task_group_t *group);
+/**
+ * @brief Runs func over [begin, end) split into chunks of grain elements
+ * and returns once every chunk has been processed. Chunk boundaries are
+ * always begin + k * grain.
+ *
+ * @param begin First index
+ * @param end One past the last index
+ * @param grain Number of indices per chunk
+ * @param func Function called as func(arg, chunk_begin, chunk_end)
+ * @param arg Argument passed to func
+ */
+void parallel_for(size_t begin, size_t end, size_t grain,
+                  void (*func)(void *, size_t, size_t), void *arg);
+/**
+ * @brief Convenience wrapper of parallel_for for lambdas and other callable
+ * objects taking (chunk_begin, chunk_end).
+ *
+ */
+template <typename F>
+static inline void parallel_for(size_t begin, size_t end, size_t grain, F &fn)
+{
+    parallel_for(begin, end, grain, [](void *arg, size_t lo, size_t hi) {
+        (*(F *)arg)(lo, hi);
+    }, &fn);
+}
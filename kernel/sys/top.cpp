@@ -0,0 +1,184 @@
+/**
+ * @file top.cpp
+ * @author Panix Contributors
+ * @brief Live CPU usage monitor
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/top.hpp>
+#include <lib/stdio.hpp>
+#include <lib/string.hpp>
+#include <dev/serial/rs232.hpp>
+#include <arch/arch.hpp>
+
+typedef struct top_collect
+{
+    size_t count;
+    top_task_t tasks[TOP_MAX_TASKS];
+} top_collect_t;
+
+static uint32_t _outputs;
+static top_sample_t _latest;
+// totals seen by the previous sample, to turn them into rates
+static top_collect_t _prev;
+static uint64_t _prev_time;
+static uint64_t _prev_idle;
+
+static void _collect(task_t *task, void *arg)
+{
+    top_collect_t *collect = (top_collect_t *)arg;
+    if (collect->count == TOP_MAX_TASKS) return;
+    top_task_t *entry = &collect->tasks[collect->count++];
+    entry->task = task;
+    size_t len = 0;
+    if (task->name != NULL) {
+        while (len < TOP_NAME_LEN - 1 && task->name[len] != '\0') {
+            entry->name[len] = task->name[len];
+            len++;
+        }
+    }
+    entry->name[len] = '\0';
+    entry->state = task->state;
+    entry->time_used = task->time_used;
+    // total for now, made relative to the previous sample later
+    entry->switches = task->sched_stats.stats.nr_voluntary + task->sched_stats.stats.nr_involuntary;
+}
+
+static const top_task_t *_find_prev(const top_task_t *entry)
+{
+    for (size_t i = 0; i < _prev.count; i++) {
+        if (_prev.tasks[i].task == entry->task) return &_prev.tasks[i];
+    }
+    return NULL;
+}
+
+static uint32_t _permille(uint64_t part, uint64_t whole)
+{
+    if (whole == 0) return 0;
+    uint64_t permille = (part * 1000) / whole;
+    return permille > 1000 ? 1000 : (uint32_t)permille;
+}
+
+static void _sample(top_sample_t *sample)
+{
+    static top_collect_t collect;
+    collect.count = 0;
+    // bring our own run time up to date, everyone else's is current
+    // since they aren't running
+    tasks_get_self_time();
+    uint32_t flags = interrupts_save();
+    uint64_t now = tasks_get_time();
+    uint64_t idle = this_cpu()->idle_time;
+    interrupts_restore(flags);
+    tasks_for_each(_collect, &collect);
+
+    sample->interval_ns = now - _prev_time;
+    sample->idle_permille = _permille(idle - _prev_idle, sample->interval_ns);
+    sample->nr_tasks = collect.count;
+    for (size_t i = 0; i < collect.count; i++) {
+        top_task_t entry = collect.tasks[i];
+        const top_task_t *prev = _find_prev(&entry);
+        // a task we haven't seen, or a recycled task_t, counts from zero
+        uint64_t ran = entry.time_used;
+        uint32_t switches = entry.switches;
+        if (prev != NULL && prev->time_used <= entry.time_used) {
+            ran -= prev->time_used;
+            // the counts go back to zero on schedstat_reset()
+            if (prev->switches <= switches) switches -= prev->switches;
+        }
+        entry.cpu_permille = _permille(ran, sample->interval_ns);
+        entry.switches = switches;
+        // insertion sort, busiest first
+        size_t pos = i;
+        while (pos > 0 && sample->tasks[pos - 1].cpu_permille < entry.cpu_permille) {
+            sample->tasks[pos] = sample->tasks[pos - 1];
+            pos--;
+        }
+        sample->tasks[pos] = entry;
+    }
+    _prev = collect;
+    _prev_time = now;
+    _prev_idle = idle;
+}
+
+static void _draw_line(size_t row, const char *line)
+{
+    kprintf("\e[s\e[%u;%uf%-40s\e[u", TOP_VGA_ROW + row, TOP_VGA_COL, line);
+}
+
+static void _draw(const top_sample_t *sample)
+{
+    static_assert(TOP_VGA_WIDTH == 40, "the padding in _draw_line must match the width");
+    char line[TOP_VGA_WIDTH + 1];
+    ksprintf(line, "idle %3u.%u%%  tasks %u", sample->idle_permille / 10,
+        sample->idle_permille % 10, sample->nr_tasks);
+    _draw_line(0, line);
+    for (size_t row = 1; row < TOP_VGA_ROWS; row++) {
+        line[0] = '\0';
+        if (row - 1 < sample->nr_tasks) {
+            const top_task_t *task = &sample->tasks[row - 1];
+            // 15 + 9 + 7 + 6 characters
+            ksprintf(line, "%-14s %-8s %3u.%u%% %5u", task->name, tasks_state_name(task->state),
+                task->cpu_permille / 10, task->cpu_permille % 10, task->switches);
+        }
+        _draw_line(row, line);
+    }
+}
+
+static void _stream(const top_sample_t *sample)
+{
+    // top <interval us> <idle permille> <tasks>
+    rs232::printf("top %u %u %u\n", (uint32_t)(sample->interval_ns / 1000),
+        sample->idle_permille, sample->nr_tasks);
+    // task <name> <state> <cpu permille> <switches> <total ms>
+    for (size_t i = 0; i < sample->nr_tasks; i++) {
+        const top_task_t *task = &sample->tasks[i];
+        rs232::printf("task %s %s %u %u %u\n", task->name, tasks_state_name(task->state),
+            task->cpu_permille, task->switches, (uint32_t)(task->time_used / 1000000));
+    }
+}
+
+static void _top_monitor()
+{
+    static top_sample_t sample;
+    uint64_t next = tasks_get_time();
+    for (;;) {
+        next += TOP_INTERVAL_NS;
+        tasks_nano_sleep_until(next);
+        _sample(&sample);
+        uint32_t flags = interrupts_save();
+        _latest = sample;
+        interrupts_restore(flags);
+        uint32_t outputs = __atomic_load_n(&_outputs, __ATOMIC_RELAXED);
+        if (outputs & TOP_OUTPUT_VGA) _draw(&sample);
+        if (outputs & TOP_OUTPUT_SERIAL) _stream(&sample);
+    }
+}
+
+void top_init(uint32_t outputs)
+{
+    _outputs = outputs;
+    _prev_time = tasks_get_time();
+    _prev_idle = this_cpu()->idle_time;
+    tasks_new(_top_monitor, NULL, TASK_READY, "[top]");
+}
+
+void top_set_outputs(uint32_t outputs)
+{
+    __atomic_store_n(&_outputs, outputs, __ATOMIC_RELAXED);
+}
+
+uint32_t top_get_outputs()
+{
+    return __atomic_load_n(&_outputs, __ATOMIC_RELAXED);
+}
+
+void top_get_sample(top_sample_t *sample)
+{
+    uint32_t flags = interrupts_save();
+    *sample = _latest;
+    interrupts_restore(flags);
+}
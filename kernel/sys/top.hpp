@@ -0,0 +1,79 @@
+/**
+ * @file top.hpp
+ * @author Panix Contributors
+ * @brief Live CPU usage monitor. The [top] task samples every task's
+ * run time once per interval and reports each task's share of the CPU,
+ * its state and how often it was switched, along with the idle share.
+ * The busiest tasks are drawn to a region of the screen and can also be
+ * streamed over serial.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/tasks.hpp>
+
+#define TOP_INTERVAL_NS     (1000ULL * 1000 * 1000)
+// most tasks tracked per sample, the rest are left out
+#define TOP_MAX_TASKS       32
+#define TOP_NAME_LEN        16
+// screen region the monitor draws into (1-based rows like the other
+// status lines), one header line and then the busiest tasks
+#define TOP_VGA_ROW         12
+#define TOP_VGA_COL         40
+#define TOP_VGA_ROWS        10
+#define TOP_VGA_WIDTH       40
+
+enum top_output
+{
+    TOP_OUTPUT_VGA = 1 << 0,
+    TOP_OUTPUT_SERIAL = 1 << 1,
+};
+
+typedef struct top_task
+{
+    const task_t *task;         // for telling tasks apart only, may be gone
+    char name[TOP_NAME_LEN];
+    task_state state;
+    uint32_t cpu_permille;      // share of the interval it ran for
+    uint32_t switches;          // times it was switched out during the interval
+    uint64_t time_used;         // total nanoseconds it has run for
+} top_task_t;
+
+typedef struct top_sample
+{
+    uint64_t interval_ns;
+    uint32_t idle_permille;     // share of the interval the CPU was idle
+    size_t nr_tasks;
+    top_task_t tasks[TOP_MAX_TASKS];    // busiest first
+} top_sample_t;
+
+/**
+ * @brief Starts the [top] task. Must be called after tasks_init().
+ *
+ * @param outputs Where to report to (top_output flags)
+ */
+void top_init(uint32_t outputs);
+/**
+ * @brief Changes where the monitor reports to.
+ *
+ * @param outputs top_output flags, 0 to only keep sampling
+ */
+void top_set_outputs(uint32_t outputs);
+/**
+ * @brief Gets where the monitor reports to.
+ *
+ * @return uint32_t top_output flags
+ */
+uint32_t top_get_outputs();
+/**
+ * @brief Gets the latest sample.
+ *
+ * @param sample Filled in with the sample
+ */
+void top_get_sample(top_sample_t *sample);
@@ -0,0 +1,154 @@
+/**
+ * @file waitable.cpp
+ * @author Panix Contributors
+ * @brief Waiting on several objects at once
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/waitable.hpp>
+#include <lib/errno.h>
+#include <arch/arch.hpp>
+
+// the state of one wait_any() call, shared by its poll entries
+typedef struct poll_wait
+{
+    uint32_t notified;  // set by waitable_notify() before waking the task
+    tasks_sync_t sync;
+} poll_wait_t;
+
+void waitable_init(waitable_t *waitable, bool (*ready)(void *owner), void *owner)
+{
+    *waitable = {
+        .ready = ready,
+        .owner = owner,
+        .pollers = NULL,
+    };
+}
+
+void waitable_add(waitable_t *waitable, poll_entry_t *entry)
+{
+    uint32_t flags = interrupts_save();
+    entry->next = waitable->pollers;
+    waitable->pollers = entry;
+    interrupts_restore(flags);
+}
+
+void waitable_remove(waitable_t *waitable, poll_entry_t *entry)
+{
+    uint32_t flags = interrupts_save();
+    for (poll_entry_t **link = &waitable->pollers; *link != NULL; link = &(*link)->next) {
+        if (*link == entry) {
+            *link = entry->next;
+            break;
+        }
+    }
+    interrupts_restore(flags);
+}
+
+void waitable_notify(waitable_t *waitable)
+{
+    // entries often live on the waiters' stacks and are only added
+    // and removed with interrupts disabled. A notify callback may
+    // remove its own entry, so the next one is fetched first.
+    uint32_t flags = interrupts_save();
+    poll_entry_t *next;
+    for (poll_entry_t *entry = waitable->pollers; entry != NULL; entry = next) {
+        next = entry->next;
+        entry->notify(entry);
+    }
+    interrupts_restore(flags);
+}
+
+static void _poll_wake(poll_entry_t *entry)
+{
+    poll_wait_t *wait = (poll_wait_t *)entry->data;
+    __atomic_store_n(&wait->notified, 1, __ATOMIC_RELEASE);
+    tasks_sync_wake_one(&wait->sync);
+}
+
+int wait_any(waitable_t *const objects[], size_t count, uint64_t timeout_ns)
+{
+    if (count == 0 || count > WAIT_ANY_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t deadline = TASKS_NO_TIMEOUT;
+    if (timeout_ns != TASKS_NO_TIMEOUT) {
+        deadline = tasks_get_time() + timeout_ns;
+    }
+    poll_wait_t wait;
+    wait.notified = 0;
+    tasks_sync_init(&wait.sync);
+    wait.sync.dbg_name = "wait_any";
+    poll_entry_t entries[WAIT_ANY_MAX];
+
+    for (size_t i = 0; i < count; i++) {
+        entries[i].notify = _poll_wake;
+        entries[i].data = &wait;
+        waitable_add(objects[i], &entries[i]);
+    }
+
+    int result = -1;
+    for (;;) {
+        // clear the flag before checking, so that a change that happens
+        // after the check is sure to stop us from going to sleep
+        __atomic_store_n(&wait.notified, 0, __ATOMIC_RELEASE);
+        for (size_t i = 0; i < count; i++) {
+            if (objects[i]->ready(objects[i]->owner)) {
+                result = (int)i;
+                break;
+            }
+        }
+        if (result != -1) break;
+        if (tasks_sync_wait_until(&wait.sync, &wait.notified, 0, deadline) == -1 &&
+            errno == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        waitable_remove(objects[i], &entries[i]);
+    }
+    if (result == -1) {
+        errno = ETIMEDOUT;
+    }
+    return result;
+}
+
+static bool _wait_timer_ready(void *owner)
+{
+    wait_timer_t *timer = (wait_timer_t *)owner;
+    return __atomic_load_n(&timer->expired, __ATOMIC_ACQUIRE) != 0;
+}
+
+static void _wait_timer_expired(hrtimer_t *hrtimer)
+{
+    wait_timer_t *timer = (wait_timer_t *)hrtimer->data;
+    __atomic_add_fetch(&timer->expired, 1, __ATOMIC_RELEASE);
+    waitable_notify(&timer->waitable);
+}
+
+void wait_timer_init(wait_timer_t *timer)
+{
+    waitable_init(&timer->waitable, _wait_timer_ready, timer);
+    hrtimer_init(&timer->timer, _wait_timer_expired, timer, HRTIMER_MODE_HARD);
+    timer->expired = 0;
+}
+
+void wait_timer_start(wait_timer_t *timer, uint64_t expires, uint64_t period)
+{
+    hrtimer_start(&timer->timer, expires, period);
+}
+
+void wait_timer_cancel(wait_timer_t *timer)
+{
+    hrtimer_cancel(&timer->timer);
+}
+
+uint32_t wait_timer_ack(wait_timer_t *timer)
+{
+    return __atomic_exchange_n(&timer->expired, 0, __ATOMIC_ACQ_REL);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file waitable.hpp
+ * @author Panix Contributors
+ * @brief Waiting on several objects at once. Objects that can be waited
+ * on embed a waitable_t, which knows how to check whether the object is
+ * ready and which tasks are waiting for it to become ready. wait_any()
+ * sleeps until one of a set of objects is ready, like poll().
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/tasks.hpp>
+#include <sys/hrtimer.hpp>
+
+// most objects a single wait_any() call can wait on
+#define WAIT_ANY_MAX 16
+
+typedef struct poll_entry poll_entry_t;
+struct poll_entry
+{
+    poll_entry_t *next;
+    // called with interrupts disabled when the object may have become
+    // ready, must not block
+    void (*notify)(poll_entry_t *entry);
+    void *data;
+};
+
+typedef struct waitable
+{
+    // whether a wait on the object would succeed right now
+    bool (*ready)(void *owner);
+    void *owner;
+    // tasks in wait_any() and other parties waiting for the object
+    poll_entry_t *pollers;
+} waitable_t;
+
+/**
+ * @brief Initializes a waitable.
+ *
+ * @param waitable Waitable to initialize
+ * @param ready Checks whether the object is ready, must not block
+ * and may be called with interrupts disabled
+ * @param owner Object passed to ready
+ */
+void waitable_init(waitable_t *waitable, bool (*ready)(void *owner), void *owner);
+/**
+ * @brief Registers an entry to be notified when the object may have
+ * become ready. The entry stays registered until it is removed.
+ *
+ * @param waitable Object to watch
+ * @param entry Entry to notify, with notify and data set
+ */
+void waitable_add(waitable_t *waitable, poll_entry_t *entry);
+/**
+ * @brief Unregisters an entry added with waitable_add(). Once this
+ * returns, the entry won't be notified again.
+ *
+ * @param waitable Object being watched
+ * @param entry Entry to remove
+ */
+void waitable_remove(waitable_t *waitable, poll_entry_t *entry);
+/**
+ * @brief Notifies everyone waiting for the object to become ready. Called
+ * by the object after any change that may have made it ready. Safe to
+ * call from any context.
+ *
+ * @param waitable Object that changed
+ */
+void waitable_notify(waitable_t *waitable);
+/**
+ * @brief Sleeps until at least one of the objects is ready. Being ready
+ * only means that a wait would succeed at that moment; the object still
+ * has to be taken with its own non-blocking call (which can fail if
+ * another task got there first).
+ *
+ * @param objects Objects to wait for
+ * @param count Number of objects, at most WAIT_ANY_MAX
+ * @param timeout_ns Nanoseconds to wait for at most, or TASKS_NO_TIMEOUT
+ * @return int Index of the first ready object, or -1 with errno set to
+ * ETIMEDOUT if none became ready in time, or to EINVAL if count is 0
+ * or too large.
+ */
+int wait_any(waitable_t *const objects[], size_t count, uint64_t timeout_ns);
+
+/**
+ * @brief A timer that can be waited on with wait_any(). It is ready
+ * once it has expired and until the expiries are acknowledged.
+ *
+ */
+typedef struct wait_timer
+{
+    waitable_t waitable;
+    hrtimer_t timer;
+    uint32_t expired;   // expiries not acknowledged yet
+} wait_timer_t;
+
+/**
+ * @brief Initializes a waitable timer.
+ *
+ * @param timer Timer to initialize
+ */
+void wait_timer_init(wait_timer_t *timer);
+/**
+ * @brief Arms a waitable timer (see hrtimer_start()).
+ *
+ * @param timer Timer to arm
+ * @param expires Absolute expiry time (nanoseconds since boot)
+ * @param period Nanoseconds between expiries, or 0 for a one-shot timer
+ */
+void wait_timer_start(wait_timer_t *timer, uint64_t expires, uint64_t period);
+/**
+ * @brief Disarms a waitable timer. Expiries that already happened still
+ * have to be acknowledged.
+ *
+ * @param timer Timer to disarm
+ */
+void wait_timer_cancel(wait_timer_t *timer);
+/**
+ * @brief Acknowledges the expiries of a waitable timer, which makes it
+ * not ready again.
+ *
+ * @param timer Timer to acknowledge
+ * @return uint32_t Number of times it expired since the last call
+ */
+uint32_t wait_timer_ack(wait_timer_t *timer);
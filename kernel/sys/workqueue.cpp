@@ -0,0 +1,85 @@
+/**
+ * @file workqueue.cpp
+ * @author Panix Contributors
+ * @brief Work queues serviced by kernel worker tasks
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <sys/workqueue.hpp>
+#include <arch/arch.hpp>
+
+workqueue_t system_wq;
+
+static void _worker_impl(void *arg);
+
+void work_init(work_t *work, void (*func)(void *), void *data)
+{
+    *work = {
+        .next = NULL,
+        .func = func,
+        .data = data,
+        .pending = 0,
+    };
+}
+
+void workqueue_init(workqueue_t *wq, const char *name)
+{
+    // items may have been queued before the worker existed, keep them
+    uint32_t flags = interrupts_save();
+    wq->name = name;
+    tasks_sync_init(&wq->idle);
+    wq->idle.dbg_name = name;
+    interrupts_restore(flags);
+    wq->worker = tasks_new_arg(_worker_impl, wq, NULL, TASK_READY, name);
+}
+
+bool workqueue_queue(workqueue_t *wq, work_t *work)
+{
+    uint32_t flags = interrupts_save();
+    if (work->pending) {
+        interrupts_restore(flags);
+        return false;
+    }
+    work->pending = 1;
+    work->next = NULL;
+    if (wq->tail != NULL) {
+        wq->tail->next = work;
+    } else {
+        wq->head = work;
+    }
+    wq->tail = work;
+    bool waiting = wq->idle.waiting.head != NULL;
+    interrupts_restore(flags);
+    // only poke the scheduler when the worker is actually asleep
+    if (waiting) {
+        tasks_sync_unblock(&wq->idle);
+    }
+    return true;
+}
+
+static void _worker_impl(void *arg)
+{
+    workqueue_t *wq = (workqueue_t *)arg;
+    for (;;) {
+        interrupts_off();
+        work_t *work = wq->head;
+        if (work == NULL) {
+            // interrupts stay disabled until we are on the wait list,
+            // so a work item queued from an IRQ can't be missed
+            tasks_sync_block(&wq->idle);
+            continue;
+        }
+        wq->head = work->next;
+        if (wq->head == NULL) {
+            wq->tail = NULL;
+        }
+        work->next = NULL;
+        // clear first so the item may queue itself again
+        work->pending = 0;
+        interrupts_on();
+        work->func(work->data);
+    }
+}
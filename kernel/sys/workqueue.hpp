@@ -0,0 +1,75 @@
+/**
+ * @file workqueue.hpp
+ * @author Panix Contributors
+ * @brief Work queues serviced by kernel worker tasks. Unlike tasklets,
+ * work items run in task context, so they may block, take a Mutex or
+ * print to the screen.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <sys/tasks.hpp>
+
+typedef struct work work_t;
+struct work
+{
+    work_t *next;
+    void (*func)(void *);
+    void *data;
+    uint32_t pending;
+};
+
+typedef struct workqueue
+{
+    const char *name;
+    work_t *head;
+    work_t *tail;
+    tasks_sync_t idle;      // the worker waits here for new work
+    task_t *worker;
+} workqueue_t;
+
+// Shared queue serviced by the [kworker] task
+extern workqueue_t system_wq;
+
+/**
+ * @brief Initializes a work item.
+ *
+ * @param work Work item to initialize
+ * @param func Function to run
+ * @param data Argument passed to the function
+ */
+void work_init(work_t *work, void (*func)(void *), void *data);
+/**
+ * @brief Initializes a work queue and starts its worker task.
+ * Must be called after tasks_init().
+ *
+ * @param wq Work queue to initialize
+ * @param name Name of the worker task
+ */
+void workqueue_init(workqueue_t *wq, const char *name);
+/**
+ * @brief Queues a work item. Safe to call from interrupt context. Items
+ * queued before the worker exists are run once it starts.
+ *
+ * @param wq Work queue
+ * @param work Work item
+ * @return true The item was queued
+ * @return false The item was already pending
+ */
+bool workqueue_queue(workqueue_t *wq, work_t *work);
+/**
+ * @brief Queues a work item on the system work queue.
+ *
+ * @param work Work item
+ * @return true The item was queued
+ * @return false The item was already pending
+ */
+static inline bool schedule_work(work_t *work)
+{
+    return workqueue_queue(&system_wq, work);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file test-seqlock.cpp
+ * @author Panix Contributors
+ * @brief Seqlock unit tests
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <catch2/catch.hpp>
+// Seqlock is header-only
+#include <lib/seqlock.hpp>
+
+TEST_CASE("seqlock operations", "[seqlock]") {
+    Seqlock lock;
+    // A read with no writer in between is consistent
+    SECTION("read") {
+        uint32_t seq = lock.ReadBegin();
+        REQUIRE((seq & 1) == 0);
+        REQUIRE_FALSE(lock.ReadRetry(seq));
+    }
+    // A read that overlaps a completed write must be retried
+    SECTION("read during write") {
+        uint32_t seq = lock.ReadBegin();
+        lock.WriteBegin();
+        REQUIRE(lock.ReadRetry(seq));
+        lock.WriteEnd();
+        REQUIRE(lock.ReadRetry(seq));
+    }
+    // Reads after a write see the new, even, sequence number
+    SECTION("read after write") {
+        uint32_t before = lock.ReadBegin();
+        lock.WriteBegin();
+        lock.WriteEnd();
+        uint32_t after = lock.ReadBegin();
+        REQUIRE(after != before);
+        REQUIRE((after & 1) == 0);
+        REQUIRE_FALSE(lock.ReadRetry(after));
+    }
+}
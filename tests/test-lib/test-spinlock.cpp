@@ -0,0 +1,92 @@
+/**
+ * @file test-spinlock.cpp
+ * @author Panix Contributors
+ * @brief Spinlock unit tests
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright the Panix Contributors (c) 2026
+ *
+ */
+#include <catch2/catch.hpp>
+// The locks are header-only
+#include <lib/spinlock.hpp>
+
+TEST_CASE("ticket lock operations", "[spinlock]") {
+    TicketLock lock;
+    REQUIRE_FALSE(lock.IsLocked());
+    // Lock and unlock hand out consecutive tickets
+    SECTION("lock") {
+        for (int i = 0; i < 3; i++) {
+            lock.Lock();
+            REQUIRE(lock.IsLocked());
+            lock.Unlock();
+            REQUIRE_FALSE(lock.IsLocked());
+        }
+    }
+    // TryLock fails while the lock is held
+    SECTION("try lock") {
+        REQUIRE(lock.TryLock());
+        REQUIRE(lock.IsLocked());
+        REQUIRE_FALSE(lock.TryLock());
+        lock.Unlock();
+        REQUIRE(lock.TryLock());
+        lock.Unlock();
+        REQUIRE_FALSE(lock.IsLocked());
+    }
+    SECTION("irqsave") {
+        uint32_t flags = lock.LockIrqSave();
+        REQUIRE(lock.IsLocked());
+        lock.UnlockIrqRestore(flags);
+        REQUIRE_FALSE(lock.IsLocked());
+    }
+}
+
+TEST_CASE("mcs lock operations", "[spinlock]") {
+    McsLock lock;
+    McsLock::Node node;
+    McsLock::Node other;
+    REQUIRE_FALSE(lock.IsLocked());
+    SECTION("lock") {
+        lock.Lock(node);
+        REQUIRE(lock.IsLocked());
+        lock.Unlock(node);
+        REQUIRE_FALSE(lock.IsLocked());
+    }
+    // TryLock fails while the lock is held, whatever node is used
+    SECTION("try lock") {
+        REQUIRE(lock.TryLock(node));
+        REQUIRE_FALSE(lock.TryLock(other));
+        lock.Unlock(node);
+        REQUIRE(lock.TryLock(other));
+        lock.Unlock(other);
+        REQUIRE_FALSE(lock.IsLocked());
+    }
+    // The lock is handed to the node queued behind the holder
+    SECTION("handoff") {
+        lock.Lock(node);
+        other.next = nullptr;
+        other.waiting = 1;
+        node.next = &other;
+        lock.Unlock(node);
+        REQUIRE(other.waiting == 0);
+    }
+    SECTION("irqsave") {
+        uint32_t flags = lock.LockIrqSave(node);
+        REQUIRE(lock.IsLocked());
+        lock.UnlockIrqRestore(node, flags);
+        REQUIRE_FALSE(lock.IsLocked());
+    }
+}
+
+TEST_CASE("spinlock classes", "[spinlock]") {
+    static spinlock_class_t test_class = SPINLOCK_CLASS_INIT("test");
+    // A class is registered once, on its first contention
+    spinlock_detail::contended(&test_class, 10);
+    spinlock_detail::contended(&test_class, 4);
+    REQUIRE(test_class.contended == 2);
+    REQUIRE(test_class.spins == 14);
+    REQUIRE(test_class.max_spins == 10);
+    REQUIRE(spinlock_classes == &test_class);
+    REQUIRE(test_class.next == nullptr);
+}